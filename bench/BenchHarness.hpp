@@ -0,0 +1,138 @@
+//
+// Created by chaku on 27/11/23.
+//
+
+#ifndef STABBY2D_BENCHHARNESS_HPP
+#define STABBY2D_BENCHHARNESS_HPP
+
+// Minimal benchmark harness, no third party code. Each benchmark times one repetition through the BenchRun it
+// is handed (setup outside Start()/Stop() is not measured) and is repeated until both a minimum time and a
+// minimum number of repetitions are reached. Results are per item: the benchmark says how many items one
+// repetition processes.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// the bench executable's CMake build type, recorded in json reports so baselines are only compared like for like
+#ifndef STABBY2D_BUILD_TYPE
+#define STABBY2D_BUILD_TYPE ""
+#endif
+
+// @brief Keep value (and whatever computed it) from being optimised away
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BenchRun {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point m_start;
+  Clock::duration m_elapsed{};
+
+public:
+  void Start() { m_start = Clock::now(); }
+  void Stop() { m_elapsed += Clock::now() - m_start; }
+  double Nanoseconds() const { return std::chrono::duration<double, std::nano>(m_elapsed).count(); }
+};
+
+struct BenchResult {
+  std::string name;
+  uint64_t items;// per repetition
+  uint64_t repetitions;
+  double medianNsPerItem;
+  double minNsPerItem;
+};
+
+struct BenchOptions {
+  std::string filter;// substring of the benchmark names to run, empty runs all
+  std::chrono::milliseconds minTime{200};
+  uint64_t minRepetitions{5};
+  uint64_t maxRepetitions{1000};
+  std::FILE* report{stdout};// human readable progress
+};
+
+class BenchHarness {
+  struct Benchmark {
+    std::string name;
+    uint64_t items;
+    std::function<void(BenchRun&)> fn;
+  };
+  std::vector<Benchmark> m_benchmarks;
+
+public:
+  void Add(std::string name, uint64_t items, std::function<void(BenchRun&)> fn) {
+    m_benchmarks.push_back({ std::move(name), std::max<uint64_t>(items, 1), std::move(fn) });
+  }
+
+  std::vector<BenchResult> Run(const BenchOptions& options) const {
+    std::vector<BenchResult> results;
+    for (const auto& benchmark : m_benchmarks) {
+      if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) { continue; }
+      BenchRun warmup;
+      benchmark.fn(warmup);
+
+      std::vector<double> samples;
+      double total = 0.0;
+      const auto minTime = std::chrono::duration<double, std::nano>(options.minTime).count();
+      while (samples.size() < options.maxRepetitions && (samples.size() < options.minRepetitions || total < minTime)) {
+        BenchRun run;
+        benchmark.fn(run);
+        samples.push_back(run.Nanoseconds() / static_cast<double>(benchmark.items));
+        total += run.Nanoseconds();
+      }
+      std::sort(samples.begin(), samples.end());
+      results.push_back({ benchmark.name, benchmark.items, samples.size(), samples[samples.size() / 2], samples.front() });
+      std::fprintf(options.report, "%-40s %12.2f ns/item (min %10.2f, %llu x %llu items)\n", benchmark.name.c_str(),
+        results.back().medianNsPerItem, results.back().minNsPerItem,
+        static_cast<unsigned long long>(samples.size()), static_cast<unsigned long long>(benchmark.items));
+      std::fflush(options.report);
+    }
+    return results;
+  }
+
+  static bool WriteJson(const std::string& filePath, const std::vector<BenchResult>& results) {
+    std::FILE* file = filePath == "-" ? stdout : std::fopen(filePath.c_str(), "w");
+    if (file == nullptr) { return false; }
+    std::array<char, 256> host{};
+    if (gethostname(host.data(), host.size() - 1) != 0) { host[0] = '\0'; }
+    std::fprintf(file, "{\n  \"suite\": \"stabby2d_bench\",\n  \"build_type\": \"%s\",\n  \"host\": \"%s\",\n"
+                       "  \"results\": [", STABBY2D_BUILD_TYPE, host.data());
+    for (size_t i = 0; i < results.size(); ++i) {
+      const auto& result = results[i];
+      std::fprintf(file, "%s\n    {\"name\": \"%s\", \"items\": %llu, \"repetitions\": %llu, "
+                         "\"ns_per_item\": %.4f, \"ns_per_item_min\": %.4f}",
+        i == 0 ? "" : ",", result.name.c_str(), static_cast<unsigned long long>(result.items),
+        static_cast<unsigned long long>(result.repetitions), result.medianNsPerItem, result.minNsPerItem);
+    }
+    std::fputs("\n  ]\n}\n", file);
+    return file == stdout ? std::fflush(file) == 0 : std::fclose(file) == 0;
+  }
+
+  // @brief Run with command line options: --filter <text> --min-time-ms <n> --json <file|->
+  int Main(int argc, char* argv[]) const {
+    BenchOptions options;
+    std::string jsonFile;
+    for (int i = 1; i + 1 < argc; ++i) {
+      if (std::strcmp(argv[i], "--filter") == 0) { options.filter = argv[++i]; }
+      else if (std::strcmp(argv[i], "--min-time-ms") == 0) { options.minTime = std::chrono::milliseconds(std::atoll(argv[++i])); }
+      else if (std::strcmp(argv[i], "--json") == 0) { jsonFile = argv[++i]; }
+    }
+    if (jsonFile == "-") { options.report = stderr; }
+    const auto results = Run(options);
+    if (!jsonFile.empty() && !WriteJson(jsonFile, results)) {
+      std::fprintf(stderr, "could not write %s\n", jsonFile.c_str());
+      return 1;
+    }
+    return 0;
+  }
+};
+
+#endif// STABBY2D_BENCHHARNESS_HPP
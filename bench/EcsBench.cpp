@@ -0,0 +1,268 @@
+//
+// Created by chaku on 27/11/23.
+//
+
+// ECS microbenchmarks: entity creation, component add/remove/access, system iteration, signature matching and
+// system lookup, plus asset loading (map and prefab parsing, tile instantiation) and render submission.
+// Results are nanoseconds per entity (or per lookup, tile, prefab). Asset benchmarks read ./assets and write
+// a generated bench_tilemap.map to the working directory.
+// Usage: stabby2d_bench [--entities <n>] [--filter <text>] [--min-time-ms <n>] [--json <file|->]
+// The bench_regression test (tools/BenchGate.cpp, registered with STABBY2D_BENCH_GATE) compares the json against
+// a locally recorded baseline, see STABBY2D_BENCH_BASELINE and the bench_baseline target in CMakeLists.txt.
+
+#include "BenchHarness.hpp"
+#include "ECS.hpp"
+#include "LogSinks.hpp"
+#include "MapGenerator.hpp"
+#include "MovementSystem.hpp"
+#include "PrefabLoader.hpp"
+#include "RenderContext.hpp"
+#include "RigidBodyComponent.hpp"
+#include "Scene.hpp"
+#include "SpriteComponent.hpp"
+#include "TimeResource.hpp"
+#include "TransformComponent.hpp"
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <typeindex>
+#include <unordered_map>
+
+namespace {
+// RenderSystem without the SDL calls: same component reads, texture lookup and destination rect math
+class RenderStyleSystem : public System {
+public:
+  RenderStyleSystem() {
+    RequireComponent<TransformComponent>();
+    RequireComponent<SpriteComponent>();
+    ReadsResource<RenderContext>();
+  }
+
+  void Update() {
+    const auto* assetManager = GetResource<RenderContext>().assetManager;
+    for (auto& entity : GetEntities()) {
+      const auto transform = entity.GetComponent<TransformComponent>();
+      const auto sprite = entity.GetComponent<SpriteComponent>();
+      const SDL_Rect dstRect{ static_cast<int>(transform.position.x), static_cast<int>(transform.position.y),
+        static_cast<int>(static_cast<float>(sprite.width) * transform.scale.x),
+        static_cast<int>(static_cast<float>(sprite.height) * transform.scale.y) };
+      DoNotOptimize(dstRect);
+      DoNotOptimize(assetManager->GetTexture(sprite.name));
+    }
+  }
+};
+
+// systems that only take part in signature matching
+template <int N>
+class MatchOnlySystem : public System {
+public:
+  MatchOnlySystem() {
+    RequireComponent<TransformComponent>();
+    if constexpr (N % 2 == 0) { RequireComponent<RigidBodyComponent>(); }
+    if constexpr (N % 3 == 0) { RequireComponent<SpriteComponent>(); }
+  }
+};
+
+Prefab MovingSprite() {
+  Prefab prefab;
+  prefab.Set<TransformComponent>(Position(1.0F, 2.0F), Scale(1.0F, 1.0F), Rotation(0.0));
+  prefab.Set<RigidBodyComponent>(Velocity(10.0F, 5.0F));
+  prefab.Set<SpriteComponent>("tank-right", 32, 32, SDL_Rect{ 0, 0, 32, 32 });
+  return prefab;
+}
+
+std::vector<Entity> CreateEntities(Registry& registry, size_t count) {
+  std::vector<Entity> entities;
+  entities.reserve(count);
+  for (size_t i = 0; i < count; ++i) { entities.push_back(registry.CreateEntity()); }
+  registry.Update();
+  return entities;
+}
+
+// 256 x 256 generated tiles written the way jungle.map is, once per process
+const std::string& TileMapFile() {
+  static const std::string fileName = [] {
+    const auto tileMap = MapGenerator(MapGeneratorSettings{}).Generate(8, 8);
+    std::ofstream file("bench_tilemap.map");
+    for (uint32_t y = 0; y < tileMap.height; ++y) {
+      for (uint32_t x = 0; x < tileMap.width; ++x) { file << (x == 0 ? "" : ",") << tileMap.At(x, y); }
+      file << '\n';
+    }
+    return std::string("bench_tilemap.map");
+  }();
+  return fileName;
+}
+
+void AddAssetBenchmarks(BenchHarness& harness) {
+  constexpr uint64_t tiles = 256 * 256;
+  harness.Add("Assets/LoadTileMap", tiles, [](BenchRun& run) {
+    const auto& fileName = TileMapFile();
+    run.Start();
+    DoNotOptimize(LoadTileMap(fileName));
+    run.Stop();
+  });
+
+  harness.Add("Assets/BuildTileMap", tiles, [](BenchRun& run) {
+    const auto tileMap = LoadTileMap(TileMapFile());
+    Registry registry;
+    run.Start();
+    BuildTileMap(registry, *tileMap);
+    registry.Update();
+    run.Stop();
+  });
+
+  constexpr uint64_t prefabs = 100;
+  harness.Add("Assets/LoadPrefab", prefabs, [](BenchRun& run) {
+    PrefabLoader loader;
+    RegisterBuiltinComponents(loader);
+    run.Start();
+    for (uint64_t i = 0; i < prefabs; ++i) { DoNotOptimize(loader.Load("./assets/prefabs/tank.prefab")); }
+    run.Stop();
+  });
+}
+
+void AddBenchmarks(BenchHarness& harness, size_t entities) {
+  harness.Add("Registry/CreateEntity", entities, [entities](BenchRun& run) {
+    Registry registry;
+    run.Start();
+    for (size_t i = 0; i < entities; ++i) { registry.CreateEntity(); }
+    registry.Update();
+    run.Stop();
+  });
+
+  harness.Add("Registry/Instantiate", entities, [entities](BenchRun& run) {
+    Registry registry;
+    const auto prefab = MovingSprite();
+    run.Start();
+    DoNotOptimize(registry.Instantiate(prefab, entities));
+    run.Stop();
+  });
+
+  harness.Add("Registry/AddComponent", entities, [entities](BenchRun& run) {
+    Registry registry;
+    auto created = CreateEntities(registry, entities);
+    run.Start();
+    for (auto& entity : created) { entity.AddComponent<TransformComponent>(Position(1.0F, 1.0F), Scale(1.0F, 1.0F), 0.0); }
+    run.Stop();
+  });
+
+  harness.Add("Registry/RemoveComponent", entities, [entities](BenchRun& run) {
+    Registry registry;
+    auto created = CreateEntities(registry, entities);
+    for (auto& entity : created) { entity.AddComponent<TransformComponent>(); }
+    run.Start();
+    for (auto& entity : created) { entity.RemoveComponent<TransformComponent>(); }
+    run.Stop();
+  });
+
+  struct Scene {
+    Registry registry;
+    std::vector<Entity> entities;
+  };
+  // loading textures needs a renderer, so lookups take the lock and miss
+  auto assets = std::make_shared<const AssetManager>();
+  auto scene = std::make_shared<std::unique_ptr<Scene>>();
+  auto getScene = [scene, assets, entities]() -> Scene& {
+    if (!*scene) {
+      *scene = std::make_unique<Scene>();
+      auto& registry = (*scene)->registry;
+      registry.SetResource<TimeResource>().deltaTime = 1.0 / 60.0;
+      registry.SetResource<RenderContext>(nullptr, assets.get());
+      registry.AddSystem<MovementSystem>();
+      registry.AddSystem<RenderStyleSystem>();
+      (*scene)->entities = registry.Instantiate(MovingSprite(), entities);
+      registry.Update();
+      // random access order
+      std::shuffle((*scene)->entities.begin(), (*scene)->entities.end(), std::mt19937(42));
+    }
+    return **scene;
+  };
+
+  harness.Add("Entity/GetComponent/random", entities, [getScene](BenchRun& run) {
+    auto& scene = getScene();
+    float sum = 0.0F;
+    run.Start();
+    for (auto& entity : scene.entities) { sum += entity.GetComponent<TransformComponent>().position.x; }
+    run.Stop();
+    DoNotOptimize(sum);
+  });
+
+  harness.Add("MovementSystem/Update", entities, [getScene](BenchRun& run) {
+    auto& system = getScene().registry.GetSystem<MovementSystem>();
+    run.Start();
+    system.Update();
+    run.Stop();
+  });
+
+  harness.Add("RenderSystem-style/Update", entities, [getScene](BenchRun& run) {
+    auto& system = getScene().registry.GetSystem<RenderStyleSystem>();
+    run.Start();
+    system.Update();
+    run.Stop();
+  });
+
+  harness.Add("Registry/AddEntityToSystems", entities, [entities](BenchRun& run) {
+    Registry registry;
+    registry.AddSystem<MatchOnlySystem<0>>();
+    registry.AddSystem<MatchOnlySystem<1>>();
+    registry.AddSystem<MatchOnlySystem<2>>();
+    registry.AddSystem<MatchOnlySystem<3>>();
+    registry.AddSystem<MatchOnlySystem<4>>();
+    registry.AddSystem<MatchOnlySystem<5>>();
+    std::vector<Entity> created;
+    for (size_t i = 0; i < entities; ++i) {
+      auto entity = registry.CreateEntity();
+      entity.AddComponent<TransformComponent>();
+      if (i % 2 == 0) { entity.AddComponent<RigidBodyComponent>(); }
+      if (i % 3 == 0) { entity.AddComponent<SpriteComponent>(); }
+      created.push_back(entity);
+    }
+    run.Start();
+    for (const auto& entity : created) { registry.AddEntityToSystems(entity); }
+    run.Stop();
+  });
+
+  constexpr uint64_t lookups = 1'000'000;
+  auto lookupRegistry = std::make_shared<Registry>();
+  lookupRegistry->AddSystem<MatchOnlySystem<0>>();
+  lookupRegistry->AddSystem<MatchOnlySystem<1>>();
+  harness.Add("Registry/GetSystem", lookups * 2, [lookupRegistry](BenchRun& run) {
+    run.Start();
+    for (uint64_t i = 0; i < lookups; ++i) {
+      DoNotOptimize(&lookupRegistry->GetSystem<MatchOnlySystem<0>>());
+      DoNotOptimize(&lookupRegistry->GetSystem<MatchOnlySystem<1>>());
+    }
+    run.Stop();
+  });
+
+  // the typeid-name keyed map GetSystem used before indexed system slots, kept as a reference point
+  auto legacy = std::make_shared<std::unordered_map<std::string, std::shared_ptr<System>>>();
+  (*legacy)[std::type_index(typeid(MatchOnlySystem<0>)).name()] = std::make_shared<MatchOnlySystem<0>>();
+  (*legacy)[std::type_index(typeid(MatchOnlySystem<1>)).name()] = std::make_shared<MatchOnlySystem<1>>();
+  harness.Add("Registry/GetSystem/typeid-map", lookups * 2, [legacy](BenchRun& run) {
+    run.Start();
+    for (uint64_t i = 0; i < lookups; ++i) {
+      DoNotOptimize((*legacy)[std::type_index(typeid(MatchOnlySystem<0>)).name()].get());
+      DoNotOptimize((*legacy)[std::type_index(typeid(MatchOnlySystem<1>)).name()].get());
+    }
+    run.Stop();
+  });
+}
+}// namespace
+
+int main(int argc, char* argv[]) {
+  // keep per-entity ECS log chatter out of the report, it is still produced and therefore measured
+  LoggerConfig logConfig;
+  logConfig.sinks = { std::make_shared<RingSink>(1U << 16U) };
+  Logger::StartAsync(logConfig);
+
+  size_t entities = 10'000;
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], "--entities") == 0) { entities = std::stoull(argv[i + 1]); }
+  }
+  BenchHarness harness;
+  AddBenchmarks(harness, entities);
+  AddAssetBenchmarks(harness);
+  return harness.Main(argc, argv);
+}
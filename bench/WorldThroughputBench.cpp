@@ -0,0 +1,62 @@
+//
+// Created by chaku on 22/11/23.
+//
+
+// Measures how many world frames per second one process sustains with N independent worlds stepping
+// concurrently, all sharing one AssetManager.
+// Usage: world_throughput_bench [entitiesPerWorld] [frames]
+
+#include "PerceptionComponent.hpp"
+#include "RigidBodyComponent.hpp"
+#include "TransformComponent.hpp"
+#include "World.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+void Populate(World& world, uint32_t entities, uint32_t seed) {
+  Prefab unit;
+  unit.Set<TransformComponent>(Position(0.0F, 0.0F), Scale(1.0F, 1.0F), Rotation(0.0));
+  unit.Set<RigidBodyComponent>(Velocity(1.0F, 0.5F));
+  unit.Set<PerceptionComponent>(48.0F);
+
+  auto instances = world.GetRegistry().Instantiate(unit, entities);
+  auto state = seed * 2654435761U + 1U;
+  for (auto& entity : instances) {
+    state = state * 1664525U + 1013904223U;
+    auto& transform = entity.GetComponent<TransformComponent>();
+    transform.position.x = static_cast<float>(state % 2048U);
+    transform.position.y = static_cast<float>((state >> 11U) % 2048U);
+  }
+}
+}// namespace
+
+int main(int argc, char* argv[]) {
+  const uint32_t entitiesPerWorld = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 2000;
+  const uint64_t frames = argc > 2 ? std::stoull(argv[2]) : 300;
+  constexpr double deltaTime = 1.0 / 60.0;
+
+  const auto assets = std::make_shared<const AssetManager>();
+  const auto maxWorlds = std::max(1U, std::thread::hardware_concurrency()) * 2;
+
+  std::printf("%8s %14s %16s\n", "worlds", "world-frames/s", "entity-frames/s");
+  for (uint32_t worldCount = 1; worldCount <= maxWorlds; worldCount *= 2) {
+    std::vector<World> worlds;
+    worlds.reserve(worldCount);
+    for (uint32_t w = 0; w < worldCount; ++w) {
+      worlds.emplace_back(assets);
+      Populate(worlds.back(), entitiesPerWorld, w);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    RunWorlds(worlds, frames, deltaTime);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const auto worldFrames = static_cast<double>(worldCount * frames) / elapsed.count();
+    std::printf("%8u %14.1f %16.0f\n", worldCount, worldFrames, worldFrames * entitiesPerWorld);
+  }
+  return 0;
+}
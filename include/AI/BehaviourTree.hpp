@@ -0,0 +1,80 @@
+//
+// Created by chaku on 08/11/23.
+//
+
+#ifndef STABBY2D_BEHAVIOURTREE_HPP
+#define STABBY2D_BEHAVIOURTREE_HPP
+
+#include "BehaviourComponent.hpp"
+#include "ECS.hpp"
+#include <cstdint>
+#include <vector>
+
+enum class BtStatus : uint8_t { Success, Failure, Running };
+
+enum class BtNodeType : uint8_t {
+  Sequence,// ticks children in order until one does not succeed
+  Selector,// ticks children in order until one does not fail
+  Inverter,// single child, swaps success and failure
+  Action// leaf, calls a function from the tree's action table
+};
+
+// Leaves are plain function pointers, there is no virtual dispatch anywhere in a tick
+using BtAction = BtStatus (*)(Entity& entity, Blackboard& blackboard, double deltaTime);
+
+// Nodes are stored in pre-order, so the children of node i start at i + 1 and the subtree of node i
+// ends at `end`. Walking a tree is index arithmetic over one contiguous array.
+struct BtNode {
+  BtNodeType type;
+  uint16_t end;// one past the last node of this subtree
+  uint16_t action;// index into the action table, Action nodes only
+};
+
+// Immutable compiled tree, shared by every agent running it. Per agent state lives in BehaviourComponent.
+class BehaviourTree {
+private:
+  std::vector<BtNode> m_nodes;
+  std::vector<BtAction> m_actions;
+
+  // @param resume node that was running at the start of this tick, -1 if none
+  auto Evaluate(uint16_t index, int32_t resume, Entity& entity, BehaviourComponent& state, double deltaTime) const
+    -> BtStatus;
+
+public:
+  BehaviourTree(std::vector<BtNode> nodes, std::vector<BtAction> actions)
+    : m_nodes(std::move(nodes)), m_actions(std::move(actions)) {}
+
+  [[nodiscard]] auto Nodes() const -> const std::vector<BtNode>& { return m_nodes; }
+
+  // @brief Tick the tree once for an agent. Composites resume at the child holding the node that
+  // returned Running last tick, children before it are not re-evaluated.
+  auto Tick(Entity& entity, BehaviourComponent& state, double deltaTime) const -> BtStatus;
+};
+
+// Builds a BehaviourTree from nested calls, e.g.
+//   BehaviourTreeBuilder().Selector()
+//       .Sequence().Action(SeesTarget).Action(Attack).End()
+//       .Action(Patrol)
+//     .End().Build();
+class BehaviourTreeBuilder {
+private:
+  std::vector<BtNode> m_nodes;
+  std::vector<BtAction> m_actions;
+  std::vector<uint16_t> m_open;// composites still waiting for End()
+  bool m_valid{ true };
+
+  auto Open(BtNodeType type) -> BehaviourTreeBuilder&;
+
+public:
+  auto Sequence() -> BehaviourTreeBuilder& { return Open(BtNodeType::Sequence); }
+  auto Selector() -> BehaviourTreeBuilder& { return Open(BtNodeType::Selector); }
+  auto Inverter() -> BehaviourTreeBuilder& { return Open(BtNodeType::Inverter); }
+  auto Action(BtAction action) -> BehaviourTreeBuilder&;
+  auto End() -> BehaviourTreeBuilder&;
+
+  // @brief Compile the tree, every opened composite must be closed with End().
+  // A malformed tree is logged and compiles to an empty tree that always fails.
+  [[nodiscard]] auto Build() const -> BehaviourTree;
+};
+
+#endif// STABBY2D_BEHAVIOURTREE_HPP
@@ -7,19 +7,44 @@
 
 #include <unordered_map>
 #include <memory>
+#include <shared_mutex>
 #include <string>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+// Lookups are const and take a shared lock, so once loaded one AssetManager can be read from any number of
+// threads (e.g. several worlds) while loading and clearing take an exclusive lock.
 class AssetManager
 {
 private:
   std::unordered_map<std::string, SDL_Texture*> textures;
+  mutable std::shared_mutex texturesMutex;
+  size_t textureBytes{ 0 };
+
+  // takes ownership, replaces (and destroys) an earlier texture of the same name
+  void StoreTexture(const std::string& name, SDL_Texture* texture);
 
 public:
+  AssetManager() = default;
+  ~AssetManager() = default;
+  AssetManager(const AssetManager&) = delete;
+  AssetManager& operator=(const AssetManager&) = delete;
+  AssetManager(AssetManager&&) = delete;
+  AssetManager& operator=(AssetManager&&) = delete;
+
   void ClearAssets();
   void AddTexture(const std::string& name, const std::string& filePath, SDL_Renderer* renderer);
-  SDL_Texture*& GetTexture(const std::string& key);
+  // @brief Decode an image file without touching the renderer, so it can run on any thread
+  // @return nullptr on failure, otherwise a surface the caller owns (or hands to AddTexture)
+  static SDL_Surface* DecodeImage(const std::string& filePath);
+  // @brief Upload a decoded image, takes ownership of surface
+  void AddTexture(const std::string& name, SDL_Surface* surface, SDL_Renderer* renderer);
+  // @brief A width x height texture of one colour, for generated scenes
+  void AddSolidTexture(const std::string& name, int width, int height, SDL_Color colour, SDL_Renderer* renderer);
+  // @return nullptr if no texture was loaded under key
+  SDL_Texture* GetTexture(const std::string& key) const;
+  // @return estimated video memory of all loaded textures, 4 bytes per texel
+  size_t GetTextureBytes() const;
 };
 
 
@@ -0,0 +1,25 @@
+//
+// Created by chaku on 08/11/23.
+//
+
+#ifndef STABBY2D_BEHAVIOURCOMPONENT_HPP
+#define STABBY2D_BEHAVIOURCOMPONENT_HPP
+
+#include <array>
+#include <cstdint>
+
+constexpr uint8_t BLACKBOARD_SLOTS = 8;
+
+// Fixed size scratch memory for a behaviour tree, slot meaning is up to the tree's actions
+struct Blackboard {
+  std::array<float, BLACKBOARD_SLOTS> values{};
+};
+
+// Per agent behaviour state, stored in the registry pool like any other component
+struct BehaviourComponent {
+  uint16_t treeId{};
+  int32_t runningNode{ -1 };// node that returned Running last tick, -1 if none
+  Blackboard blackboard{};
+};
+
+#endif// STABBY2D_BEHAVIOURCOMPONENT_HPP
@@ -0,0 +1,14 @@
+//
+// Created by chaku on 05/11/23.
+//
+
+#ifndef STABBY2D_PERCEPTIONCOMPONENT_HPP
+#define STABBY2D_PERCEPTIONCOMPONENT_HPP
+
+// Entities with a PerceptionComponent are visible to the PerceptionSystem.
+// An entity with visionRange 0 can be seen but does not look for targets itself.
+struct PerceptionComponent {
+  float visionRange{};
+};
+
+#endif// STABBY2D_PERCEPTIONCOMPONENT_HPP
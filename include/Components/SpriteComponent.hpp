@@ -5,6 +5,7 @@
 #ifndef STABBY2D_SPRITECOMPONENT_HPP
 #define STABBY2D_SPRITECOMPONENT_HPP
 
+#include <SDL2/SDL.h>
 #include <string>
 #include <utility>
 
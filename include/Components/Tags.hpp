@@ -0,0 +1,15 @@
+//
+// Created by chaku on 13/11/23.
+//
+
+#ifndef STABBY2D_TAGS_HPP
+#define STABBY2D_TAGS_HPP
+
+// Tag components carry no data, they only set a bit in the entity Signature (see IsTagComponent)
+struct PlayerTag {};
+struct EnemyTag {};
+struct StaticTag {};// never moves, e.g. map tiles
+struct VisibleTag {};
+struct ChurnTag {};// stress scene sprite, StressChurnSystem may despawn it
+
+#endif// STABBY2D_TAGS_HPP
@@ -2,12 +2,19 @@
 #define ECS_HPP
 
 #include "Logger.hpp"
+#include <algorithm>
+#include <atomic>
 #include <bitset>
+#include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
-#include <set>
-#include <typeindex>
-#include <unordered_map>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
 constexpr uint8_t MAX_COMPONENTS = 32;
@@ -15,9 +22,14 @@ constexpr uint8_t MAX_COMPONENTS = 32;
 // This is done using a bitset as a map for component IDs. If in the bitset position i is set it means Component with ID i is set for a System
 using Signature = std::bitset<MAX_COMPONENTS>;
 
+// Empty component types are tags (Player, Enemy, Static, ...). A tag only occupies its bit in the entity
+// Signature, it never gets a Pool, and filtering on it is a signature mask test.
+template <typename TComponent>
+inline constexpr bool IsTagComponent = std::is_empty_v<TComponent>;
+
 class IComponent {
 protected:
-  inline static unsigned int m_nextId;
+  inline static std::atomic<unsigned int> m_nextId;
 };
 
 template <typename T>
@@ -29,6 +41,40 @@ public:
   }
 };
 
+// Resources are registry wide singletons (time, render context, map info...). Like components every
+// resource type gets a sequential ID, which indexes straight into the registry's resource slots.
+constexpr uint8_t MAX_RESOURCES = 32;
+using ResourceSignature = std::bitset<MAX_RESOURCES>;
+
+class IResource {
+protected:
+  inline static std::atomic<unsigned int> m_nextId;
+};
+
+template <typename T>
+class Resource : public IResource {
+public:
+  static unsigned int GetId() {
+    static const auto resourceId = m_nextId++;
+    return resourceId;
+  }
+};
+
+// System types get sequential IDs too, so looking a system up is a vector index instead of a map lookup
+class ISystemType {
+protected:
+  inline static std::atomic<unsigned int> m_nextId;
+};
+
+template <typename T>
+class SystemType : public ISystemType {
+public:
+  static unsigned int GetId() {
+    static const auto systemId = m_nextId++;
+    return systemId;
+  }
+};
+
 // Fwd declaration for Registry
 class Registry;
 
@@ -47,33 +93,104 @@ public:
     bool operator<(const Entity& other) const { return m_entityId < other.m_entityId; }
     bool operator>(const Entity& other) const { return m_entityId > other.m_entityId; }
 
-    Registry* registry;
+    Registry* registry{nullptr};
+    // @brief Registry::KillEntity on this entity
+    void Kill() const;
     template <typename TComponent, typename ...TArgs> void AddComponent(TArgs&& ...args);
     template <typename TComponent> void RemoveComponent();
     template <typename TComponent> bool HasComponent() const;
-    template <typename TComponent> TComponent& GetComponent();
+    // the entity is a handle, a const one still reaches a mutable component
+    template <typename TComponent> TComponent& GetComponent() const;
 };
 
 // System processes specific m_entities
 class System {
 private:
    Signature m_componentSignature;
+   Signature m_excludedSignature;
+   ResourceSignature m_resourceReads;
+   ResourceSignature m_resourceWrites;
    std::vector<Entity> m_entities;
+   // by entity ID, whether m_entities holds it. Membership is fixed when the entity is added, removing a
+   // component later doesn't change it, so it can't be derived from the signature.
+   std::vector<bool> m_tracked;
+
+   void SetTracked(const Entity& entity, bool tracked);
+
+   // Incremental locality sort. A pass snapshots (key, entity) pairs once, sorts the snapshot in runs that
+   // are then merged pairwise, and finally writes the entity order back. Each step is resumable, so a pass
+   // can span several frames. Entities appended meanwhile stay behind the sorted ones. A removal restarts
+   // the pass, because the snapshot would bring the entity back.
+   enum class SortPhase : uint8_t { Idle, Snapshot, Runs, Merge };
+   using KeyedEntity = std::pair<uint64_t, Entity>;
+   std::function<uint64_t(Entity&)> m_sortKey;
+   bool m_resortContinuously{false};
+   bool m_sortDirty{true};// entities were added (or the key changed) since the last completed pass
+   bool m_removedDuringSort{false};
+   SortPhase m_sortPhase{SortPhase::Idle};
+   size_t m_sortCursor{0};
+   size_t m_sortWidth{0};
+   std::vector<KeyedEntity> m_sortKeys;
+   std::vector<KeyedEntity> m_sortMerged;
 
 public:
+   using SortKey = std::function<uint64_t(Entity& entity)>;
+   using Clock = std::chrono::steady_clock;
+
+   // set by Registry::AddSystem
+   Registry* registry{nullptr};
+   const std::type_info* type{&typeid(System)};
+
    void AddEntity(const Entity& entity);
+   void AddEntities(std::span<const Entity> entities);
    void RemoveEntity(Entity& entity);
-   std::vector<Entity> GetEntities() const;
+   // @brief Drop every tracked entity found in entities, which must be sorted
+   void RemoveEntities(std::span<const Entity> entities);
+   // @brief Whether the entity is in this system's list
+   bool Tracks(const Entity& entity) const;
+   // @brief View of the tracked entities, invalidated when the list changes (Registry::Update, locality sorting)
+   std::span<const Entity> GetEntities() const;
+   size_t GetEntityCount() const;
    Signature const& GetComponentSignature() const;
+   Signature const& GetExcludedSignature() const;
+   // entity has every required component and none of the excluded ones, systems requiring nothing match nothing
+   bool Matches(const Signature& entitySignature) const;
 
    // Valid m_entities must have atleast one component
    template <typename TComponent> void RequireComponent();
+   // Entities having this component are not tracked, mostly useful with tags (e.g. skip Static in movement)
+   template <typename TComponent> void ExcludeComponent();
+
+   // Declared resource access, lets a scheduler tell which systems may run side by side
+   template <typename TResource> void ReadsResource();
+   template <typename TResource> void WritesResource();
+   ResourceSignature const& GetResourceReads() const;
+   ResourceSignature const& GetResourceWrites() const;
+   // true if one of the systems writes a resource the other one reads or writes
+   bool ConflictsWith(const System& other) const;
+
+   template <typename TResource> TResource& GetResource() const;
+
+   // Iteration order used by SortEntities. Without a key entities are ordered by ID, which is also their
+   // index in every Pool, so iteration streams through component memory front to back. Keys that change
+   // as the game runs (e.g. a Morton code of the position) should set continuous so sorting starts over
+   // once the list is in order.
+   void SetSortKey(SortKey key, bool continuous = false);
+   // @brief Advance the locality sort pass until it completes or the deadline passes
+   // @return true if the pass completed (or there was nothing to sort)
+   bool SortEntities(Clock::time_point deadline);
 };
 
 // IPool is pure virtual base class
 class IPool {
 public:
     virtual ~IPool() {} // virtual destructor
+
+    // storage figures for Registry::GetStats
+    virtual size_t SlotCount() const = 0;
+    virtual size_t SlotCapacity() const = 0;
+    virtual size_t ElementSize() const = 0;
+    virtual const std::type_info& ElementType() const = 0;
 };
 
 // Pool is a container to store components
@@ -107,6 +224,11 @@ public:
       return m_data.size();
   }
 
+  size_t SlotCount() const override { return m_data.size(); }
+  size_t SlotCapacity() const override { return m_data.capacity(); }
+  size_t ElementSize() const override { return sizeof(T); }
+  const std::type_info& ElementType() const override { return typeid(T); }
+
   // @brief vector::reserve if n is greater than underlying container size, vector::resize otherwise
   // @param n
   // @return void
@@ -120,6 +242,8 @@ public:
   auto Set(size_t index, T& object) -> void { m_data[index] = object;
   }
 
+  auto Data() -> T* { return m_data.data(); }
+
   auto Get(size_t index) -> T& {
       return static_cast<T&>(m_data[index]);
   }
@@ -129,8 +253,68 @@ public:
   }
 };
 
+// Prefab is a reusable set of component default values, instantiated in bulk by Registry::Instantiate.
+// Component ids, the signature and type-erased copy routines are resolved once when the prefab is built.
+class Prefab {
+private:
+  friend class Registry;
+
+  struct Blueprint {
+    unsigned int componentId;
+    std::shared_ptr<const void> value;
+    std::shared_ptr<IPool> (*makePool)();
+    // copy *value into pool slots [first, first + count)
+    void (*fill)(IPool& pool, const void* value, size_t first, size_t count);
+  };
+
+  Signature m_signature;
+  std::vector<Blueprint> m_components;
+
+  template <typename TComponent> static std::shared_ptr<IPool> MakePool();
+  template <typename TComponent> static void Fill(IPool& pool, const void* value, size_t first, size_t count);
+
+public:
+  // @brief Add a component default, replacing an earlier value of the same type
+  template <typename TComponent, typename ...TArgs> Prefab& Set(TArgs&& ...args);
+  Signature const& GetSignature() const { return m_signature; }
+};
+
 // registry class is responsible for creating, removing and tracking m_entities, components and m_systems
+// Memory and occupancy of one component pool. Pools are indexed by entity ID, so every slot below the highest
+// ID that ever had the component exists whether or not its entity still has it.
+struct ComponentPoolStats {
+  unsigned int componentId;
+  std::string name;
+  size_t capacity;// allocated slots
+  size_t slots;// slots in use by the ID range
+  size_t live;// entities that currently have the component
+  size_t bytes;// capacity * element size, heap owned by the elements themselves is not included
+  double fragmentation;// share of allocated slots not holding a live component
+};
+
+struct SystemStats {
+  std::string name;
+  size_t entities;
+};
+
+struct RegistryStats {
+  size_t entities;// IDs handed out
+  size_t freeIds;// IDs of killed entities waiting to be reused
+  size_t pendingEntities;// created but not yet handed to systems
+  size_t signatureCount;
+  size_t signatureBytes;
+  size_t componentBytes;// sum over pools
+  std::vector<ComponentPoolStats> pools;
+  std::vector<SystemStats> systems;
+};
+
+// @brief Snapshot as a JSON object, for dashboards
+std::string ToJson(const RegistryStats& stats);
+
 class Registry {
+public:
+  using ComponentCallback = std::function<void(std::span<const Entity> entities)>;
+
 private:
   size_t m_numEntities = 0;
 
@@ -140,66 +324,200 @@ private:
   // tracks which component is turned 'on' (i.e. Signature) per entity.
   std::vector<Signature> m_entityComponentSignatures;
 
-  // track each system type with map
-  std::unordered_map<std::string, std::shared_ptr<System>> m_systems;
+  // m_systems[SystemType<T>::GetId()] owns the system of type T (or is empty),
+  // m_systemOrder lists the registered systems densely in the order they were added
+  std::vector<std::shared_ptr<System>> m_systems;
+  std::vector<System*> m_systemOrder;
+  size_t m_localityCursor = 0;
 
   // only add/delete m_entities at the end of game loop
-  std::set<Entity> m_entitiesToBeAdded;
-  std::set<Entity> m_entitiesToBeKilled;
+  std::vector<Entity> m_entitiesToBeAdded;
+  std::vector<Entity> m_entitiesToBeKilled;// may hold duplicates, sorted and deduplicated in Update()
+  // IDs of killed entities, CreateEntity() hands the most recently freed out first
+  std::vector<size_t> m_freeIds;
+
+  // prefab instances wait here as whole batches until the end of game loop
+  struct EntityBatch {
+    Signature signature;
+    std::vector<Entity> entities;
+  };
+  std::vector<EntityBatch> m_batchesToBeAdded;
+
+  // resource slots indexed by Resource<T>::GetId(), empty until set
+  std::vector<std::shared_ptr<void>> m_resources;
+
+  // Component add/remove observers, indexed by component ID. Events are queued while the frame runs and
+  // handed to the callbacks as one span per component type in Update(). Types without observers queue nothing.
+  struct ComponentObservers {
+    std::vector<ComponentCallback> onAdded;
+    std::vector<ComponentCallback> onRemoved;
+    std::vector<Entity> added;
+    std::vector<Entity> removed;
+  };
+  std::vector<ComponentObservers> m_componentObservers;
+  std::vector<Entity> m_componentEventScratch;
+  // observers registered by callbacks while events are dispatched, appended once dispatch is done so the
+  // callback lists (and m_componentObservers) never grow under the running callback
+  struct PendingObserver {
+    unsigned int componentId;
+    bool onAdded;
+    ComponentCallback callback;
+  };
+  std::vector<PendingObserver> m_pendingObservers;
+  bool m_dispatchingComponentEvents{ false };
+
+  void AddComponentObserver(unsigned int componentId, bool onAdded, ComponentCallback callback);
+  void QueueComponentAdded(unsigned int componentId, const Entity& entity);
+  void QueueComponentRemoved(unsigned int componentId, const Entity& entity);
+  void FlushComponentEvents();
 
 public:
   // Entity management
+  // Reuses the ID of a killed entity when there is one
   Entity CreateEntity();
+  // Create count entities from a prefab, their components are copied in bulk and they join
+  // systems as one batch in the next Update(). Batches always take fresh, contiguous IDs.
+  std::vector<Entity> Instantiate(const Prefab& prefab, size_t count);
+  // @brief Remove the entity from every system and free its ID in the next Update(). Its components read as
+  // removed from then on (observers are told) and the ID goes to a later CreateEntity(). Kill an entity once.
+  void KillEntity(const Entity& entity);
+  // number of entity ids handed out so far, killed ones included
+  size_t GetEntityCount() const { return m_numEntities; }
+  size_t GetLiveEntityCount() const { return m_numEntities - m_freeIds.size(); }
 
   // Component management
   template<typename TComponent, typename ...TArgs> void AddComponent(Entity& entity, TArgs&& ...args);
   template<typename TComponent> void RemoveComponent(Entity& entity);
-  template<typename TComponent> bool HasComponent(Entity& entity) const;
-  template<typename TComponent> TComponent& GetComponent(Entity& entity) const;
+  template<typename TComponent> bool HasComponent(const Entity& entity) const;
+  template<typename TComponent> TComponent& GetComponent(const Entity& entity) const;
+
+  // Component observers, called from Update() with every entity that gained/lost the component since the
+  // last Update(). Adding and removing within one frame reports both events.
+  template<typename TComponent> void OnComponentAdded(ComponentCallback callback);
+  template<typename TComponent> void OnComponentRemoved(ComponentCallback callback);
+
+  // Resource management
+  template<typename TResource, typename ...TArgs> TResource& SetResource(TArgs&& ...args);
+  template<typename TResource> bool HasResource() const;
+  // @brief The resource must have been set (asserted in debug builds), check HasResource when unsure
+  template<typename TResource> TResource& GetResource() const;
 
   // System management
   template<typename TSystem, typename ...TArgs> void AddSystem(TArgs&& ...args);
   template<typename TSystem> void RemoveSystem();
-  template<typename TSystem> bool HasSystem();
-  template<typename TSystem> TSystem& GetSystem();
+  template<typename TSystem> bool HasSystem() const;
+  template<typename TSystem> TSystem& GetSystem() const;
+  // registered systems in execution (i.e. registration) order
+  std::span<System* const> GetSystems() const;
+
+  Signature const& GetSignature(const Entity& entity) const;
 
   // If an entity's component signature matches to that of a system's required components,
   // add that entity to the system
   void AddEntityToSystems(const Entity& entity);
   void Update();
+
+  // Introspection: per pool memory and occupancy, per system entity counts. Walks every signature, meant for
+  // periodic reporting rather than per frame use.
+  RegistryStats GetStats() const;
+  // @brief GetStats as log lines, one per pool and system. Logged in every build and never rate limited.
+  void LogStats() const;
+
+  // Spend up to budget re-sorting system entity lists into locality order, a bit every frame.
+  // Systems are visited round robin, so a big list can't starve the others.
+  void OptimizeLocality(std::chrono::microseconds budget);
 };
 
+template <typename TComponent>
+std::shared_ptr<IPool> Prefab::MakePool() {
+  return std::make_shared<Pool<TComponent>>();
+}
+
+template <typename TComponent>
+void Prefab::Fill(IPool& pool, const void* value, size_t first, size_t count) {
+  auto& typedPool = static_cast<Pool<TComponent>&>(pool);
+  if (typedPool.Size() < first + count) {
+    typedPool.Resize(first + count);
+  }
+  const auto& component = *static_cast<const TComponent*>(value);
+  TComponent* data = typedPool.Data() + first;
+  if constexpr (std::is_trivially_copyable_v<TComponent>) {
+    // seed one copy then double the initialised range with memcpy
+    std::memcpy(static_cast<void*>(data), &component, sizeof(TComponent));
+    for (size_t done = 1; done < count;) {
+      const auto chunk = std::min(done, count - done);
+      std::memcpy(static_cast<void*>(data + done), data, chunk * sizeof(TComponent));
+      done += chunk;
+    }
+  } else {
+    std::fill_n(data, count, component);
+  }
+}
+
+template <typename TComponent, typename ...TArgs>
+Prefab& Prefab::Set(TArgs&& ...args) {
+  const auto componentId = Component<TComponent>::GetId();
+  m_signature.set(componentId);
+  // tags only need their signature bit, Pool<T> code is never instantiated for them
+  if constexpr (!IsTagComponent<TComponent>) {
+    std::erase_if(m_components, [componentId](const Blueprint& blueprint) {
+      return blueprint.componentId == componentId;
+    });
+    m_components.push_back({ componentId,
+      std::make_shared<const TComponent>(TComponent(std::forward<TArgs>(args)...)),
+      &Prefab::MakePool<TComponent>,
+      &Prefab::Fill<TComponent> });
+  }
+  return *this;
+}
+
+template <typename... TComponents>
+Signature MakeSignature() {
+  Signature signature;
+  (signature.set(Component<TComponents>::GetId()), ...);
+  return signature;
+}
+
 template<typename TComponent>
 void System::RequireComponent() {
   m_componentSignature.set(Component<TComponent>::GetId());
 };
 
+template<typename TComponent>
+void System::ExcludeComponent() {
+  m_excludedSignature.set(Component<TComponent>::GetId());
+};
+
 template<typename TComponent, typename... TArgs>
 inline void Registry:: AddComponent(Entity &entity, TArgs &&...args) {
   const auto componentId = Component<TComponent>::GetId();
   const auto entityId = entity.GetId();
 
-  // resize if component ID is greater than what m_componentPools can hold
-  if (componentId >= m_componentPools.size()) {
-      m_componentPools.resize(componentId + 1, nullptr);
-  }
+  QueueComponentAdded(componentId, entity);
 
-  // create Pool for a Component type if it doesn't exist
-  if (!m_componentPools[componentId]) {
-      m_componentPools[componentId] = std::make_shared<Pool<TComponent>>();
-  }
+  // tags only set their signature bit, Pool<T> code is never instantiated for them
+  if constexpr (!IsTagComponent<TComponent>) {
+    // resize if component ID is greater than what m_componentPools can hold
+    if (componentId >= m_componentPools.size()) {
+        m_componentPools.resize(componentId + 1, nullptr);
+    }
 
-  std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(m_componentPools[componentId]);
+    // create Pool for a Component type if it doesn't exist
+    if (!m_componentPools[componentId]) {
+        m_componentPools[componentId] = std::make_shared<Pool<TComponent>>();
+    }
 
-  if (entityId >= componentPool->Size()) {
-    componentPool->Resize(m_numEntities);
-  }
+    std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(m_componentPools[componentId]);
 
-  TComponent newComponent(std::forward<TArgs>(args)...);
+    if (entityId >= componentPool->Size()) {
+      componentPool->Resize(m_numEntities);
+    }
 
-  componentPool->Set(entityId, newComponent);
+    TComponent newComponent(std::forward<TArgs>(args)...);
+
+    componentPool->Set(entityId, newComponent);
+  }
 
-  m_entityComponentSignatures.resize(m_componentPools.size());
   m_entityComponentSignatures[entityId].set(componentId);
 };
 
@@ -208,11 +526,24 @@ inline void Registry::RemoveComponent(Entity &entity) {
   auto const componentId = Component<TComponent>::GetId();
   auto const entityId = entity.GetId();
 
+  if (m_entityComponentSignatures[entityId].test(componentId)) {
+    QueueComponentRemoved(componentId, entity);
+  }
   m_entityComponentSignatures[entityId].set(componentId, false);
 };
 
 template<typename TComponent>
-inline bool Registry::HasComponent(Entity &entity) const {
+inline void Registry::OnComponentAdded(ComponentCallback callback) {
+  AddComponentObserver(Component<TComponent>::GetId(), true, std::move(callback));
+};
+
+template<typename TComponent>
+inline void Registry::OnComponentRemoved(ComponentCallback callback) {
+  AddComponentObserver(Component<TComponent>::GetId(), false, std::move(callback));
+};
+
+template<typename TComponent>
+inline bool Registry::HasComponent(const Entity &entity) const {
   auto const componentId = Component<TComponent>::GetId();
   auto const entityId = entity.GetId();
 
@@ -220,7 +551,8 @@ inline bool Registry::HasComponent(Entity &entity) const {
 };
 
 template<typename TComponent>
-TComponent& Registry::GetComponent(Entity &entity) const {
+TComponent& Registry::GetComponent(const Entity &entity) const {
+  static_assert(!IsTagComponent<TComponent>, "tag components have no storage, use HasComponent");
   const auto componentId = Component<TComponent>::GetId();
   const auto entityId = entity.GetId();
   auto componentPool = std::static_pointer_cast<Pool<TComponent>>(m_componentPools[componentId]);
@@ -229,27 +561,84 @@ TComponent& Registry::GetComponent(Entity &entity) const {
 
 template<typename TSystem, typename... TArgs>
 inline void Registry::AddSystem(TArgs&& ...args) {
-  m_systems[std::string(std::type_index(typeid(TSystem)).name())] =
-    std::make_shared<TSystem>(TSystem(std::forward<TArgs>(args)...));
+  const auto systemId = SystemType<TSystem>::GetId();
+  if (systemId >= m_systems.size()) {
+    m_systems.resize(systemId + 1, nullptr);
+  }
+
+  auto system = std::make_shared<TSystem>(std::forward<TArgs>(args)...);
+  system->registry = this;
+  system->type = &typeid(TSystem);
+
+  // re-adding a system replaces it but keeps its place in the execution order
+  auto& slot = m_systems[systemId];
+  const auto position = std::find(m_systemOrder.begin(), m_systemOrder.end(), slot.get());
+  if (slot && position != m_systemOrder.end()) {
+    *position = system.get();
+  } else {
+    m_systemOrder.push_back(system.get());
+  }
+  slot = std::move(system);
+};
+
+template<typename TResource, typename... TArgs>
+inline TResource& Registry::SetResource(TArgs&& ...args) {
+  const auto resourceId = Resource<TResource>::GetId();
+  if (resourceId >= m_resources.size()) {
+    m_resources.resize(resourceId + 1, nullptr);
+  }
+  auto resource = std::make_shared<TResource>(std::forward<TArgs>(args)...);
+  auto& value = *resource;
+  m_resources[resourceId] = std::move(resource);
+  return value;
+};
+
+template<typename TResource>
+inline bool Registry::HasResource() const {
+  const auto resourceId = Resource<TResource>::GetId();
+  return resourceId < m_resources.size() && m_resources[resourceId] != nullptr;
+};
+
+template<typename TResource>
+inline TResource& Registry::GetResource() const {
+  assert(HasResource<TResource>() && "GetResource of a resource that was never set");
+  return *static_cast<TResource*>(m_resources[Resource<TResource>::GetId()].get());
+};
+
+template<typename TResource>
+void System::ReadsResource() {
+  m_resourceReads.set(Resource<TResource>::GetId());
+};
+
+template<typename TResource>
+void System::WritesResource() {
+  m_resourceWrites.set(Resource<TResource>::GetId());
+};
+
+template<typename TResource>
+TResource& System::GetResource() const {
+  return registry->GetResource<TResource>();
 };
 
 template<typename TSystem>
 inline void Registry::RemoveSystem(){
-  std::erase_if(
-    m_systems, [](const auto& item) {
-      return item.first == std::string(std::type_index(typeid(TSystem)).name());
-  });
+  if (!HasSystem<TSystem>()) {
+    return;
+  }
+  auto& slot = m_systems[SystemType<TSystem>::GetId()];
+  std::erase(m_systemOrder, slot.get());
+  slot.reset();
 };
 
 template<typename TSystem>
-inline bool Registry::HasSystem() {
-  return m_systems.count(std::string(std::type_index(typeid(TSystem)).name()));
+inline bool Registry::HasSystem() const {
+  const auto systemId = SystemType<TSystem>::GetId();
+  return systemId < m_systems.size() && m_systems[systemId] != nullptr;
 };
 
 template<typename TSystem>
-inline TSystem& Registry::GetSystem() {
-  std::string key(std::type_index(typeid(TSystem)).name());
-  return *std::static_pointer_cast<TSystem>(m_systems[key]);
+inline TSystem& Registry::GetSystem() const {
+  return static_cast<TSystem&>(*m_systems[SystemType<TSystem>::GetId()]);
 };
 
 template <typename TComponent, typename ...TArgs>
@@ -257,6 +646,10 @@ void Entity::AddComponent(TArgs&&... args) {
   registry->AddComponent<TComponent>(*this, std::forward<TArgs>(args)...);
 };
 
+inline void Entity::Kill() const {
+  registry->KillEntity(*this);
+}
+
 template <typename TComponent>
 void Entity::RemoveComponent() {
   registry->RemoveComponent<TComponent>(*this);
@@ -268,7 +661,7 @@ bool Entity::HasComponent() const {
 };
 
 template <typename TComponent>
-TComponent& Entity::GetComponent() {
+TComponent& Entity::GetComponent() const {
   return registry->GetComponent<TComponent>(*this);
 };
 
@@ -4,21 +4,52 @@
 #include "../ECS/ECS.hpp"
 #include "../Logger/Logger.hpp"//TODO: Replace with spdlog at some point
 #include "AssetManager.hpp"
+#include "FrameStats.hpp"
+#include "MapGenerator.hpp"
+#include "Scene.hpp"
+#include "World.hpp"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <glm/glm.hpp>
+#include <chrono>
+#include <optional>
 
 const auto FPS = 60;
 constexpr auto MILLISECS_PER_FRAME = 1000 / FPS;
 
+// Feeds World::Step stage timings into FrameStats for the debug overlay
+class FrameStatsObserver : public StageObserver {
+  using Clock = std::chrono::steady_clock;
+  FrameStats* m_stats{ nullptr };
+  std::array<Clock::time_point, FrameStats::MAX_STAGES> m_started{};
+
+public:
+  void SetStats(FrameStats* stats) { m_stats = stats; }
+  void BeginStage(size_t stage) override {
+    if (stage < m_started.size()) { m_started[stage] = Clock::now(); }
+  }
+  void EndStage(size_t stage) override {
+    if (m_stats != nullptr && stage < m_started.size()) {
+      m_stats->stageMs[stage].Push(std::chrono::duration<float, std::milli>(Clock::now() - m_started[stage]).count());
+    }
+  }
+};
+
 class GameState {
 private:
   bool isRunning{false};
-  SDL_Window* window;
-  SDL_Renderer* renderer;
+  SDL_Window* window{ nullptr };
+  SDL_Renderer* renderer{ nullptr };
+  std::chrono::steady_clock::time_point startupBegin{};
+  bool firstFramePresented{ false };
   uint64_t milliSecsPrevFrame = 0;
-  std::unique_ptr<Registry> registry{std::make_unique<Registry>()};
-  std::unique_ptr<AssetManager> assetStore{std::make_unique<AssetManager>()};
+  uint64_t milliSecsPrevStats = 0;
+  FrameStatsObserver stageObserver;
+  float simulateMs = 0.0F;
+  std::shared_ptr<AssetManager> assetStore{std::make_shared<AssetManager>()};
+  World world{assetStore};
+
+  SceneSettings sceneSettings;
 
 public:
   GameState() = default;
@@ -27,13 +58,19 @@ public:
   GameState& operator=(GameState&)=delete;
   GameState(GameState&&)=delete;
   GameState& operator=(GameState&&)=delete;
+  // SDL, window, renderer, textures and the scene, overlapped where they can be (see StartupPipeline)
   void Initialize();
   void ProcessInput();
+  // systems and resources, called by Initialize before the scene is loaded
   void Setup();
   void Update();
   void Render();
   void Run();
   void Destroy();
+  // generate the map instead of loading jungle.map, must be called before Initialize()
+  void UseProceduralMap(const MapGeneratorSettings& settings, uint32_t chunksX, uint32_t chunksY);
+  // replace the scene with generated sprites and tiles, must be called before Initialize()
+  void UseStressScene(const StressSceneSettings& settings);
   uint16_t windowWidth = 1024;
   uint16_t windowHeight = 768;
 };
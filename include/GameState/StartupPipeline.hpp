@@ -0,0 +1,64 @@
+//
+// Created by chaku on 09/12/23.
+//
+
+#ifndef STABBY2D_STARTUPPIPELINE_HPP
+#define STABBY2D_STARTUPPIPELINE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Startup work as a small dependency graph. Each step runs once all the steps it depends on have succeeded:
+// Main steps on the thread calling Run() (SDL video and rendering calls must stay there), Worker steps each on
+// a thread of their own, so e.g. image decoding and map parsing overlap with window creation. A step that
+// fails (returns false) skips everything depending on it. Every step records when it started and ended.
+class StartupPipeline {
+public:
+  enum class Thread : uint8_t { Main, Worker };
+  using Step = std::function<bool()>;
+
+private:
+  using Clock = std::chrono::steady_clock;
+  enum class State : uint8_t { Pending, Running, Succeeded, Failed, Skipped };
+
+  struct Node {
+    std::string name;
+    Thread thread;
+    std::vector<size_t> dependencies;
+    Step step;
+    State state{ State::Pending };
+    Clock::time_point started{};
+    Clock::time_point ended{};
+  };
+
+  std::vector<Node> m_nodes;
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  Clock::time_point m_started{};
+
+  // @brief Skip steps behind a failure and launch ready workers, call with m_mutex held
+  // @return index of a Main step ready to run, m_nodes.size() if there is none
+  size_t Advance(std::vector<std::jthread>& workers);
+  bool Finished() const;
+  void Finish(size_t index, bool succeeded);
+
+public:
+  // @param dependencies indices returned by earlier Add calls, which keeps the graph acyclic
+  // @return index to name this step as a dependency of later ones
+  size_t Add(std::string name, Thread thread, std::vector<size_t> dependencies, Step step);
+
+  // @brief Run every step, returns once all have finished or been skipped
+  // @return false if any step failed
+  bool Run();
+
+  // @brief One line per step: thread, start and end relative to Run(), duration, result
+  void LogTimings() const;
+};
+
+#endif// STABBY2D_STARTUPPIPELINE_HPP
@@ -0,0 +1,67 @@
+//
+// Created by chaku on 11/12/23.
+//
+
+#ifndef STABBY2D_JOBPOOL_HPP
+#define STABBY2D_JOBPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads that live as long as the pool, so data parallel jobs don't pay for thread creation every
+// frame. One job runs at a time and the calling thread works on it too. Work started from inside a job (e.g.
+// a world stepped by RunWorlds running its PerceptionSystem), or while another thread's job occupies the
+// pool, runs inline on the calling thread instead of oversubscribing the machine.
+class JobPool {
+public:
+  // type erased fn(index), a plain function pointer so submitting a job never allocates
+  using Invoke = void (*)(void* context, size_t index);
+
+private:
+  struct Job {
+    Invoke invoke{ nullptr };
+    void* context{ nullptr };
+    size_t count{ 0 };
+    size_t helpers{ 0 };// pool threads taking part, the first `helpers` of them
+  };
+
+  std::vector<std::jthread> m_threads;
+  std::mutex m_submitMutex;// held by the thread whose job occupies the pool
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  Job m_job;
+  uint64_t m_generation{ 0 };
+  size_t m_busyHelpers{ 0 };
+  bool m_stopping{ false };
+  std::atomic<size_t> m_next{ 0 };
+
+  void WorkerLoop(size_t index);
+  void Drain(const Job& job);
+
+public:
+  // @param threads pool threads besides the callers, 0 makes every job run inline
+  explicit JobPool(size_t threads);
+  ~JobPool();
+  JobPool(const JobPool&) = delete;
+  JobPool& operator=(const JobPool&) = delete;
+  JobPool(JobPool&&) = delete;
+  JobPool& operator=(JobPool&&) = delete;
+
+  // @brief The process wide pool ParallelFor uses, WorkerCount() - 1 threads started on first use
+  static JobPool& Shared();
+
+  // @brief Threads a job can use at most, the caller included
+  size_t Concurrency() const { return m_threads.size() + 1; }
+
+  // @brief Run invoke(context, i) for every i in [0, count) and return once all are done
+  // @param maxWorkers upper bound on threads used, the caller included, 0 means Concurrency()
+  void Run(size_t count, Invoke invoke, void* context, size_t maxWorkers = 0);
+};
+
+#endif// STABBY2D_JOBPOOL_HPP
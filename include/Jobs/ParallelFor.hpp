@@ -0,0 +1,35 @@
+//
+// Created by chaku on 02/11/23.
+//
+
+#ifndef STABBY2D_PARALLELFOR_HPP
+#define STABBY2D_PARALLELFOR_HPP
+
+#include "JobPool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+// @brief Number of worker threads to use for data parallel jobs, never less than 1
+inline auto WorkerCount() -> size_t {
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// @brief Run fn(i) for every i in [0, count) spread over the threads of JobPool::Shared().
+// Work items are handed out through an atomic counter so uneven items (e.g. map chunks) balance themselves.
+// The calling thread takes part in the work and the call returns once every item is done. Called from inside
+// another ParallelFor (or while another thread's one is running) it runs inline on the calling thread.
+// @param count number of work items
+// @param fn callable taking the item index, must be safe to call concurrently for different indices
+// @param maxWorkers upper bound on threads used, 0 means all of the pool
+template <typename TFunc>
+void ParallelFor(size_t count, TFunc&& fn, size_t maxWorkers = 0) {
+  using Func = std::remove_reference_t<TFunc>;
+  JobPool::Shared().Run(count,
+    [](void* context, size_t index) { (*static_cast<Func*>(context))(index); },
+    const_cast<void*>(static_cast<const void*>(std::addressof(fn))), maxWorkers);
+}
+
+#endif// STABBY2D_PARALLELFOR_HPP
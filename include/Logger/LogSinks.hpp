@@ -0,0 +1,83 @@
+//
+// Created by chaku on 25/11/23.
+//
+
+#ifndef STABBY2D_LOGSINKS_HPP
+#define STABBY2D_LOGSINKS_HPP
+
+#include "Logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// stdout with ANSI level colours, the default sink
+class ConsoleSink : public LogSink {
+public:
+    void Write(std::string_view text, std::span<const LogLine> lines) override;
+    void Flush() override;
+};
+
+// Appends to a file and rotates it to file.1, file.2, ... once it exceeds maxBytes or gets older than maxAge.
+// At most maxFiles rotated files are kept.
+class RotatingFileSink : public LogSink {
+    std::string m_path;
+    size_t m_maxBytes;
+    std::chrono::seconds m_maxAge;
+    unsigned int m_maxFiles;
+    std::FILE* m_file{nullptr};
+    size_t m_size{0};
+    std::chrono::steady_clock::time_point m_opened;
+
+    void Open();
+    void Rotate();
+
+public:
+    RotatingFileSink(std::string path, size_t maxBytes, std::chrono::seconds maxAge = std::chrono::hours(24),
+                     unsigned int maxFiles = 5);
+    ~RotatingFileSink() override;
+    RotatingFileSink(const RotatingFileSink&) = delete;
+    RotatingFileSink& operator=(const RotatingFileSink&) = delete;
+
+    void Write(std::string_view text, std::span<const LogLine> lines) override;
+    void Flush() override;
+};
+
+// Keeps the last capacity bytes of output in memory, for crash dumps or an in-game console
+class RingSink : public LogSink {
+    mutable std::mutex m_mutex;
+    std::vector<char> m_ring;
+    size_t m_head{0};// next byte to write
+    bool m_wrapped{false};
+
+public:
+    explicit RingSink(size_t capacity);
+
+    void Write(std::string_view text, std::span<const LogLine> lines) override;
+    // @brief The buffered lines, oldest first. A line cut in half by the wrap around is left out.
+    std::string Snapshot() const;
+};
+
+// Appends through a shared memory mapping that grows by chunkBytes at a time. Lines that reached the mapping
+// survive a crash of the process since the kernel owns the pages; the file is trimmed to its real length
+// when the sink is destroyed (a crashed run leaves zero padding at the end).
+class MappedFileSink : public LogSink {
+    int m_fd{-1};
+    char* m_mapping{nullptr};
+    size_t m_mapped{0};
+    size_t m_size{0};
+    size_t m_chunkBytes;
+
+    bool Grow(size_t needed);
+
+public:
+    explicit MappedFileSink(const std::string& path, size_t chunkBytes = 1U << 20U);
+    ~MappedFileSink() override;
+    MappedFileSink(const MappedFileSink&) = delete;
+    MappedFileSink& operator=(const MappedFileSink&) = delete;
+
+    void Write(std::string_view text, std::span<const LogLine> lines) override;
+};
+
+#endif
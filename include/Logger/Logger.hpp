@@ -1,9 +1,21 @@
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
 
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
 #include <string_view>
 #include <ostream>
+#include <type_traits>
+#include <vector>
 
 enum LogLevel {
     INFO,
@@ -11,6 +23,12 @@ enum LogLevel {
     ERR
 };
 
+// Lowest level that is compiled in, LOG_* calls below it expand to nothing and their arguments are never
+// evaluated. 0 = INFO, 1 = WARN, 2 = ERR, 3 = no logging. Set from CMake (STABBY2D_LOG_MIN_LEVEL).
+#ifndef STABBY2D_LOG_MIN_LEVEL
+#define STABBY2D_LOG_MIN_LEVEL 0
+#endif
+
 struct LogEntry {
     LogLevel lvl;
     std::string_view message;
@@ -18,14 +36,221 @@ struct LogEntry {
 };
 
 std::ostream& operator<<(std::ostream& os, const LogEntry& entry);
+// @brief ANSI escape sequence colouring terminal output of lvl
+std::string_view LogLevelColour(LogLevel lvl);
+
+// One formatted message, including its trailing newline
+struct LogLine {
+    LogLevel lvl;
+    std::string_view text;
+};
+
+// Destination of text output. The writer thread collects every line formatted during a flush interval into
+// one contiguous batch and hands it to each sink in a single call.
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+    // @brief text holds all lines of the batch back to back, lines views into it
+    virtual void Write(std::string_view text, std::span<const LogLine> lines) = 0;
+    virtual void Flush() {}
+};
+
+// What a producer does when the async queue is full
+enum class LogOverflowPolicy {
+    Block,// wait for the writer thread to make room
+    Drop,// discard the message
+    Count// discard the message, the writer reports how many were lost
+};
+
+struct LoggerConfig {
+    size_t capacity{8192};// queue slots, rounded up to a power of two
+    LogOverflowPolicy overflow{LogOverflowPolicy::Block};
+    bool flushOnCrash{true};// write out already formatted lines from fatal signal and std::terminate handlers
+    std::string binaryFile;// when set, raw records are written to this file instead of text to the sinks
+    std::vector<std::shared_ptr<LogSink>> sinks;// empty = ConsoleSink
+    std::chrono::milliseconds flushInterval{50};// how long the writer batches lines before handing them out
+};
+
+// Applied per call site, in sync and async mode alike
+struct LogLimits {
+    uint32_t messagesPerSecond{20};// further messages from the same site within a second are counted, 0 = no limit
+    bool collapseDuplicates{true};// a message identical to the previous one from its site is only counted
+};
+
+// One per LOG_* call site, created the first time the call site runs. Holds everything about a message
+// that is known at compile time, so records only carry a pointer to it plus the raw arguments.
+struct LogSite {
+    LogSite(LogLevel level, const char* formatString, const char* fileName, int lineNumber);
+    // for tools recreating the sites of a binary log, these sites are not rate limited
+    LogSite(LogLevel level, const char* formatString, const char* fileName, int lineNumber, uint32_t siteId);
+
+    const LogLevel lvl;
+    const char* const format;// "{}" placeholders are replaced by the arguments in order, "{{" and "}}" are braces
+    const char* const file;
+    const int line;
+    const uint32_t id;// sequential, in order of first use
+
+    // LogLimits bookkeeping, only touched with relaxed atomics so a misbehaving call site never blocks
+    mutable std::atomic<uint64_t> lastHash{0};// arguments of the previous message
+    mutable std::atomic<uint64_t> repeated{0};// duplicates not reported yet
+    mutable std::atomic<int64_t> windowStart{0};
+    mutable std::atomic<uint32_t> windowCount{0};
+    mutable std::atomic<uint64_t> suppressed{0};// rate limited messages not reported yet
+    const LogSite* next{nullptr};// every rate limited site is on one list, so pending counts can be reported
+};
+
+enum class LogArgType : uint8_t { Int, UInt, Double, Bool, Char, String, Pointer };
+
+// Arguments are stored as [type][raw bytes] (strings as [type][uint16 length][bytes]) and only turned
+// into text by whoever writes the record out
+constexpr size_t LOG_PAYLOAD_SIZE = 224;
+
+struct LogRecord {
+    int64_t timestamp{};// steady clock nanoseconds
+    const LogSite* site{nullptr};
+    uint16_t length{};// used payload bytes
+    bool truncated{false};// arguments did not fit into the payload
+    std::array<char, LOG_PAYLOAD_SIZE> payload;// only the first length bytes are meaningful, left uninitialised
+
+    // @brief Copy the header and the used part of the payload only
+    void CopyFrom(const LogRecord& other) {
+        timestamp = other.timestamp;
+        site = other.site;
+        length = other.length;
+        truncated = other.truncated;
+        std::memcpy(payload.data(), other.payload.data(), other.length);
+    }
+
+    void Append(LogArgType type, const void* data, size_t size) {
+        if (truncated || length + 1 + size > payload.size()) {
+            truncated = true;
+            return;
+        }
+        payload[length++] = static_cast<char>(type);
+        std::memcpy(payload.data() + length, data, size);
+        length = static_cast<uint16_t>(length + size);
+    }
+
+    void AppendString(std::string_view text) {
+        // long strings are cut to whatever space is left rather than dropped
+        if (truncated || size_t{length} + 3 > payload.size()) {
+            truncated = true;
+            return;
+        }
+        const auto room = payload.size() - length - 3;
+        const auto size = static_cast<uint16_t>(std::min(text.size(), room));
+        payload[length++] = static_cast<char>(LogArgType::String);
+        std::memcpy(payload.data() + length, &size, sizeof(size));
+        std::memcpy(payload.data() + length + sizeof(size), text.data(), size);
+        length = static_cast<uint16_t>(length + sizeof(size) + size);
+        truncated = size < text.size();
+    }
+
+    template <typename T>
+    void AppendArg(const T& value) {
+        using TValue = std::decay_t<T>;
+        if constexpr (std::is_same_v<TValue, bool>) {
+            Append(LogArgType::Bool, &value, sizeof(bool));
+        } else if constexpr (std::is_same_v<TValue, char>) {
+            Append(LogArgType::Char, &value, sizeof(char));
+        } else if constexpr (std::is_enum_v<TValue>) {
+            AppendArg(static_cast<std::underlying_type_t<TValue>>(value));
+        } else if constexpr (std::is_integral_v<TValue> && std::is_signed_v<TValue>) {
+            const auto wide = static_cast<int64_t>(value);
+            Append(LogArgType::Int, &wide, sizeof(wide));
+        } else if constexpr (std::is_integral_v<TValue>) {
+            const auto wide = static_cast<uint64_t>(value);
+            Append(LogArgType::UInt, &wide, sizeof(wide));
+        } else if constexpr (std::is_floating_point_v<TValue>) {
+            const auto wide = static_cast<double>(value);
+            Append(LogArgType::Double, &wide, sizeof(wide));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            AppendString(std::string_view(value));
+        } else if constexpr (std::is_pointer_v<TValue>) {
+            const auto address = reinterpret_cast<uintptr_t>(value);
+            Append(LogArgType::Pointer, &address, sizeof(address));
+        } else {
+            static_assert(std::is_pointer_v<TValue>, "unsupported log argument type");
+        }
+    }
+};
+
+// @brief Render a record's message (format string with the arguments substituted)
+std::string FormatLogMessage(const LogRecord& record);
+// @brief Call visit with the type and text of each argument of record, in order
+void ForEachLogArg(const LogRecord& record, const std::function<void(LogArgType, std::string_view)>& visit);
+
+// Binary log file (LoggerConfig::binaryFile), native byte order:
+//   header  [magic 8][uint32 version][int64 wall clock ns since epoch at steady clock zero]
+//   entries [uint8 LogFileTag] followed by
+//     Site    [uint32 id][uint8 level][int32 line][uint16 n][file][uint16 n][format]
+//     Record  [uint32 site id][int64 timestamp][uint8 truncated][uint16 n][payload]
+// A site is written once, before its first record.
+constexpr std::array<char, 8> LOG_FILE_MAGIC{'S', '2', 'D', 'L', 'O', 'G', '\0', '\0'};
+constexpr uint32_t LOG_FILE_VERSION = 1;
+
+enum class LogFileTag : uint8_t { Site = 1, Record = 2 };
 
 class Logger {
-    static std::vector<LogEntry> messages;
+    // @param limited apply LogLimits, false for Report
+    static void Submit(LogRecord& record, bool limited = true);
 
 public:
     static void Info(const std::string_view& message);
     static void Warn(const std::string_view& message);
     static void Error(const std::string_view& message);
+
+    // @brief Capture the arguments of a LOG_* call site, formatting happens on the writer side.
+    // Prefer the LOG_INFO/LOG_WARN/LOG_ERROR macros, they create the site and apply compile time filtering.
+    template <typename... TArgs>
+    static void Write(const LogSite& site, const TArgs&... args) {
+        LogRecord record;
+        record.site = &site;
+        (record.AppendArg(args), ...);
+        Submit(record);
+    }
+
+    // @brief Like Write, but for output that was asked for explicitly (e.g. Registry::LogStats dumps): never
+    // compiled out by STABBY2D_LOG_MIN_LEVEL, rate limited or collapsed. Use the LOG_REPORT macro.
+    template <typename... TArgs>
+    static void Report(const LogSite& site, const TArgs&... args) {
+        LogRecord record;
+        record.site = &site;
+        (record.AppendArg(args), ...);
+        Submit(record, false);
+    }
+
+    // Until StartAsync() is called, messages are written synchronously on the calling thread.
+    // Afterwards producers copy a fixed size record into a lock-free queue and a background thread
+    // formats and writes them.
+    static void StartAsync(const LoggerConfig& config = {});
+    // @brief Drain the queue and stop the writer thread, logging is synchronous again afterwards
+    static void Stop();
+    // @brief Block until every message logged so far has been written
+    static void Flush();
+    // @brief Messages discarded because the queue was full
+    static uint64_t DroppedCount();
+    static void SetLimits(const LogLimits& limits);
 };
 
-#endif
\ No newline at end of file
+#define STABBY2D_LOG(level, fmt, ...)                                                       \
+    do {                                                                                    \
+        if constexpr (static_cast<int>(level) >= STABBY2D_LOG_MIN_LEVEL) {                  \
+            static const LogSite stabby2dLogSite{level, fmt, __FILE__, __LINE__};           \
+            Logger::Write(stabby2dLogSite __VA_OPT__(,) __VA_ARGS__);                       \
+        }                                                                                   \
+    } while (false)
+
+// LOG_INFO("Entity created : {}", entityId) - arguments are copied raw and formatted by the writer
+#define LOG_INFO(fmt, ...) STABBY2D_LOG(LogLevel::INFO, fmt __VA_OPT__(,) __VA_ARGS__)
+#define LOG_WARN(fmt, ...) STABBY2D_LOG(LogLevel::WARN, fmt __VA_OPT__(,) __VA_ARGS__)
+#define LOG_ERROR(fmt, ...) STABBY2D_LOG(LogLevel::ERR, fmt __VA_OPT__(,) __VA_ARGS__)
+
+// LOG_REPORT("pool {}: {} bytes", name, bytes) - INFO level output that is there in every build, see Logger::Report
+#define LOG_REPORT(fmt, ...)                                                                \
+    do {                                                                                    \
+        static const LogSite stabby2dLogSite{LogLevel::INFO, fmt, __FILE__, __LINE__};      \
+        Logger::Report(stabby2dLogSite __VA_OPT__(,) __VA_ARGS__);                          \
+    } while (false)
+
+#endif
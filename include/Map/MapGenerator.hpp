@@ -0,0 +1,56 @@
+//
+// Created by chaku on 02/11/23.
+//
+
+#ifndef STABBY2D_MAPGENERATOR_HPP
+#define STABBY2D_MAPGENERATOR_HPP
+
+#include "TileMap.hpp"
+#include <cstdint>
+
+// Tile values for generated terrain, picked from jungle.png using the jungle.map encoding
+struct TerrainPalette {
+  int water{ 0 };
+  int sand{ 10 };
+  int grass{ 20 };
+  int forest{ 21 };
+  int bush{ 22 };
+};
+
+struct MapGeneratorSettings {
+  uint64_t seed{ 0 };
+  uint32_t chunkSize{ 32 };// tiles per chunk side
+  float noiseScale{ 0.06F };// lattice cells per tile, smaller means bigger features
+  uint8_t octaves{ 4 };
+  float waterLevel{ 0.35F };
+  float sandLevel{ 0.42F };
+  float forestDensity{ 0.45F };// chance a land tile starts out as forest before smoothing
+  uint8_t smoothingPasses{ 4 };// cellular automata passes
+  float bushChance{ 0.03F };
+  TerrainPalette palette{};
+};
+
+// Noise + cellular automata terrain generator.
+// Every chunk is a pure function of (seed, chunkX, chunkY): the height field is sampled from coordinate hashed
+// noise and the automata run on a halo wide enough that border tiles never depend on a neighbouring chunk.
+// Chunks can therefore be generated in any order, on any thread, or streamed in on demand for unbounded maps.
+class MapGenerator {
+private:
+  MapGeneratorSettings m_settings;
+
+public:
+  explicit MapGenerator(const MapGeneratorSettings& settings) : m_settings(settings) {}
+
+  [[nodiscard]] auto Settings() const -> const MapGeneratorSettings& { return m_settings; }
+
+  // @brief Seed for the chunk at (chunkX, chunkY), stable across runs and platforms
+  [[nodiscard]] auto ChunkSeed(int32_t chunkX, int32_t chunkY) const -> uint64_t;
+
+  // @brief Generate a single chunkSize x chunkSize chunk, safe to call concurrently
+  [[nodiscard]] auto GenerateChunk(int32_t chunkX, int32_t chunkY) const -> TileMap;
+
+  // @brief Generate chunksX x chunksY chunks starting at chunk (0, 0) on worker threads and stitch them
+  [[nodiscard]] auto Generate(uint32_t chunksX, uint32_t chunksY) const -> TileMap;
+};
+
+#endif// STABBY2D_MAPGENERATOR_HPP
@@ -0,0 +1,31 @@
+//
+// Created by chaku on 02/11/23.
+//
+
+#ifndef STABBY2D_TILEMAP_HPP
+#define STABBY2D_TILEMAP_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Grid of tile values, row major. A tile value encodes its source cell in the tilemap texture
+// the same way jungle.map does: column = value / 10, row = value % 10.
+struct TileMap {
+  uint32_t width{};
+  uint32_t height{};
+  std::vector<int> tiles;
+
+  TileMap() = default;
+  TileMap(uint32_t w, uint32_t h) : width(w), height(h), tiles(static_cast<size_t>(w) * h, 0) {}
+
+  auto At(uint32_t x, uint32_t y) const -> int { return tiles[static_cast<size_t>(y) * width + x]; }
+  auto At(uint32_t x, uint32_t y) -> int& { return tiles[static_cast<size_t>(y) * width + x]; }
+};
+
+// @brief Parse a comma separated .map file, one row of tiles per line
+// @return std::nullopt if the file cannot be opened
+auto LoadTileMap(const std::string& fileName) -> std::optional<TileMap>;
+
+#endif// STABBY2D_TILEMAP_HPP
@@ -0,0 +1,37 @@
+//
+// Created by chaku on 11/11/23.
+//
+
+#ifndef STABBY2D_PREFABLOADER_HPP
+#define STABBY2D_PREFABLOADER_HPP
+
+#include "ECS.hpp"
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// Reads prefab definitions from text files. Each non empty line that does not start with '#' is
+//   <ComponentName> <arguments...>
+// and is handed to the parser registered for ComponentName, which adds the component default to the prefab.
+class PrefabLoader {
+public:
+  // @return false if the arguments could not be parsed
+  using Parser = std::function<bool(std::istringstream& args, Prefab& prefab)>;
+
+private:
+  std::unordered_map<std::string, Parser> m_parsers;
+
+public:
+  void Register(const std::string& componentName, Parser parser);
+
+  // @brief Parse a prefab file
+  // @return std::nullopt if the file cannot be opened or contains an unknown or malformed component
+  std::optional<Prefab> Load(const std::string& filePath) const;
+};
+
+// @brief Register parsers for the engine's built in components
+void RegisterBuiltinComponents(PrefabLoader& loader);
+
+#endif// STABBY2D_PREFABLOADER_HPP
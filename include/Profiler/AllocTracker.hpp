@@ -0,0 +1,54 @@
+//
+// Created by chaku on 03/12/23.
+//
+
+#ifndef STABBY2D_ALLOCTRACKER_HPP
+#define STABBY2D_ALLOCTRACKER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct AllocCounters {
+    uint64_t allocations{};
+    uint64_t frees{};
+    uint64_t bytes{};// requested by the allocations, frees don't know their size
+
+    AllocCounters operator-(const AllocCounters& other) const {
+        return { allocations - other.allocations, frees - other.frees, bytes - other.bytes };
+    }
+};
+
+// One sampled allocation call stack, innermost frame first
+struct AllocSite {
+    uint64_t allocations{};
+    uint64_t bytes{};
+    std::vector<std::string> frames;
+};
+
+// Counts every global operator new / delete per thread. The hooks are only compiled in with
+// STABBY2D_ALLOC_TRACKING, otherwise every counter stays 0. Counters only grow, take the difference of two
+// reads to count what happened in between (a frame, a zone, a test).
+class AllocTracker {
+public:
+    static constexpr bool IsCompiledIn() {
+#ifdef STABBY2D_ALLOC_TRACKING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // @brief Counters of the calling thread
+    static AllocCounters Thread();
+    // @brief Counters summed over every thread, including those that have exited
+    static AllocCounters Total();
+
+    // @brief Record the call stack of every `interval`th allocation of each thread, 0 stops sampling
+    static void SetSampleInterval(uint32_t interval);
+    static void ClearSamples();
+    // @brief The `count` sampled call stacks seen most often, symbolised (slow, allocates)
+    static std::vector<AllocSite> TopSites(size_t count);
+};
+
+#endif// STABBY2D_ALLOCTRACKER_HPP
@@ -0,0 +1,66 @@
+//
+// Created by chaku on 05/12/23.
+//
+
+#ifndef STABBY2D_PERFCOUNTERS_HPP
+#define STABBY2D_PERFCOUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+enum class PerfEvent : uint8_t { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, Count };
+
+constexpr size_t PERF_EVENT_COUNT = static_cast<size_t>(PerfEvent::Count);
+
+// One reading of every counter, events that couldn't be opened read 0
+struct PerfSample {
+    std::array<uint64_t, PERF_EVENT_COUNT> values{};
+
+    uint64_t operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+    PerfSample operator-(const PerfSample& other) const {
+        PerfSample difference;
+        for (size_t i = 0; i < values.size(); ++i) { difference.values[i] = values[i] - other.values[i]; }
+        return difference;
+    }
+};
+
+// Hardware counters (Linux perf_event_open) of the calling thread only, user space only. They are opened as
+// one group, so Read() gets all of them atomically. JobPool threads are not counted: for a stage that runs
+// ParallelFor (the PerceptionSystem) the numbers cover the calling thread's share of the work only and are
+// approximate. Any counter may be missing (no PMU in a VM, perf_event_paranoid, not Linux): Open() keeps
+// whatever it could get and Read() reports 0 for the rest. Counters multiplexed by the kernel are scaled up
+// to the full running time.
+class PerfCounters {
+    std::array<int, PERF_EVENT_COUNT> m_fds;
+    std::string m_error;
+
+    // the first counter opened leads the group, -1 while there is none
+    int Leader() const {
+        for (const auto fd : m_fds) {
+            if (fd >= 0) { return fd; }
+        }
+        return -1;
+    }
+
+public:
+    PerfCounters() { m_fds.fill(-1); }
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    PerfCounters(PerfCounters&&) = delete;
+    PerfCounters& operator=(PerfCounters&&) = delete;
+
+    static const char* Name(PerfEvent event);
+
+    // @brief Open and start every counter, returns false if none could be opened (see Error())
+    bool Open();
+    bool IsAvailable(PerfEvent event) const { return m_fds[static_cast<size_t>(event)] >= 0; }
+    // @brief Why the last counter that failed to open did, empty if all opened
+    const std::string& Error() const { return m_error; }
+
+    // @brief Counts since Open(), take the difference of two samples to measure a region
+    PerfSample Read() const;
+};
+
+#endif// STABBY2D_PERFCOUNTERS_HPP
@@ -0,0 +1,77 @@
+//
+// Created by chaku on 26/11/23.
+//
+
+#ifndef STABBY2D_PROFILER_HPP
+#define STABBY2D_PROFILER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped timing zones collected into per-thread buffers while a capture is running, exported as a Chrome
+// Trace Event file (chrome://tracing, ui.perfetto.dev). Zones are only compiled in with STABBY2D_PROFILING,
+// otherwise PROFILE_SCOPE and PROFILE_FRAME expand to nothing and captures come out empty.
+class Profiler {
+public:
+    static inline std::atomic<bool> capturing{false};
+
+    static constexpr bool IsCompiledIn() {
+#ifdef STABBY2D_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // @brief Steady clock nanoseconds
+    static int64_t Now();
+
+    // @brief Start recording at the next frame mark and stop after `frames` frames, 0 records until StopCapture().
+    // Clears whatever an earlier capture left in the buffers, call it while no zone is open on other threads.
+    static void StartCapture(uint64_t frames);
+    static void StopCapture();
+    // @brief Ends the current frame and starts the next, recorded as a "Frame" zone on the calling thread.
+    // Its allocation count covers every thread.
+    static void MarkFrame();
+    // @brief Append a finished zone to the calling thread's buffer (dropped when the buffer is full).
+    // allocations is how many times the thread allocated inside the zone, see AllocTracker
+    static void Record(const char* name, int64_t start, int64_t end, uint64_t allocations = 0);
+    // @brief Allocations made by the calling thread so far, 0 without STABBY2D_ALLOC_TRACKING
+    static uint64_t ThreadAllocations();
+    // @brief Write every recorded zone as Chrome Trace Event JSON, returns false if the file can't be written
+    static bool WriteChromeTrace(const std::string& filePath);
+};
+
+// Records the time (and allocations) between construction and destruction while a capture is running
+class ProfileZone {
+    const char* m_name;
+    int64_t m_start;
+    uint64_t m_allocations{0};
+
+public:
+    explicit ProfileZone(const char* name)
+        : m_name(name), m_start(Profiler::capturing.load(std::memory_order_relaxed) ? Profiler::Now() : -1) {
+        if (m_start >= 0) { m_allocations = Profiler::ThreadAllocations(); }
+    }
+    ~ProfileZone() {
+        if (m_start >= 0) {
+            Profiler::Record(m_name, m_start, Profiler::Now(), Profiler::ThreadAllocations() - m_allocations);
+        }
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#ifdef STABBY2D_PROFILING
+#define STABBY2D_PROFILE_CONCAT_INNER(a, b) a##b
+#define STABBY2D_PROFILE_CONCAT(a, b) STABBY2D_PROFILE_CONCAT_INNER(a, b)
+// name must outlive the capture, i.e. a string literal
+#define PROFILE_SCOPE(name) const ProfileZone STABBY2D_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::MarkFrame()
+#else
+#define PROFILE_SCOPE(name) static_cast<void>(0)
+#define PROFILE_FRAME() static_cast<void>(0)
+#endif
+
+#endif// STABBY2D_PROFILER_HPP
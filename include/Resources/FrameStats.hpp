@@ -0,0 +1,68 @@
+//
+// Created by chaku on 01/12/23.
+//
+
+#ifndef STABBY2D_FRAMESTATS_HPP
+#define STABBY2D_FRAMESTATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Fixed size ring of the last N samples. One thread pushes, any thread may read without locking; a reader
+// racing the writer can see a sample from the next lap, which is fine for display.
+template <size_t N>
+class SampleRing {
+  std::array<std::atomic<float>, N> m_samples{};
+  std::atomic<uint64_t> m_written{ 0 };
+
+public:
+  static constexpr size_t Capacity() { return N; }
+
+  void Push(float sample) {
+    const auto written = m_written.load(std::memory_order_relaxed);
+    m_samples[written % N].store(sample, std::memory_order_relaxed);
+    m_written.store(written + 1, std::memory_order_release);
+  }
+
+  // @brief Number of samples held, at most N
+  size_t Size() const { return static_cast<size_t>(std::min<uint64_t>(m_written.load(std::memory_order_acquire), N)); }
+
+  // @brief The sample pushed `age` pushes ago, 0 is the latest. age must be < Size()
+  float Recent(size_t age) const {
+    const auto written = m_written.load(std::memory_order_acquire);
+    return m_samples[(written - 1 - age) % N].load(std::memory_order_relaxed);
+  }
+
+  float Mean() const {
+    const auto size = Size();
+    float sum = 0.0F;
+    for (size_t age = 0; age < size; ++age) { sum += Recent(age); }
+    return size == 0 ? 0.0F : sum / static_cast<float>(size);
+  }
+};
+
+// Frame timing and counters written by the game loop and read by DebugOverlaySystem. Everything is a ring or
+// an atomic so reading it never stalls (or perturbs) the code being measured.
+struct FrameStats {
+  static constexpr size_t HISTORY = 128;
+  static constexpr size_t MAX_STAGES = 8;
+
+  // milliseconds per frame spent stepping the world, recording draws, and in SDL_RenderPresent
+  SampleRing<HISTORY> simulateMs;
+  SampleRing<HISTORY> renderMs;
+  SampleRing<HISTORY> presentMs;
+
+  // milliseconds per World::Step stage, named by stageNames
+  std::array<SampleRing<HISTORY>, MAX_STAGES> stageMs;
+  std::span<const char* const> stageNames;
+
+  std::atomic<size_t> drawCalls{ 0 };
+  std::atomic<size_t> entities{ 0 };
+  std::atomic<size_t> textureBytes{ 0 };
+};
+
+#endif// STABBY2D_FRAMESTATS_HPP
@@ -0,0 +1,17 @@
+//
+// Created by chaku on 15/11/23.
+//
+
+#ifndef STABBY2D_MAPINFO_HPP
+#define STABBY2D_MAPINFO_HPP
+
+#include <cstdint>
+
+// Dimensions of the loaded tile map
+struct MapInfo {
+  uint32_t width{};// in tiles
+  uint32_t height{};// in tiles
+  uint32_t tileSize{};// in pixels
+};
+
+#endif// STABBY2D_MAPINFO_HPP
@@ -0,0 +1,17 @@
+//
+// Created by chaku on 15/11/23.
+//
+
+#ifndef STABBY2D_RENDERCONTEXT_HPP
+#define STABBY2D_RENDERCONTEXT_HPP
+
+#include "AssetManager.hpp"
+#include <SDL2/SDL.h>
+
+// What render systems need to draw, owned by GameState
+struct RenderContext {
+  SDL_Renderer* renderer{ nullptr };
+  const AssetManager* assetManager{ nullptr };
+};
+
+#endif// STABBY2D_RENDERCONTEXT_HPP
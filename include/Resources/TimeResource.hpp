@@ -0,0 +1,17 @@
+//
+// Created by chaku on 15/11/23.
+//
+
+#ifndef STABBY2D_TIMERESOURCE_HPP
+#define STABBY2D_TIMERESOURCE_HPP
+
+#include <cstdint>
+
+// Frame timing, written once per frame by the game loop
+struct TimeResource {
+  double deltaTime{};// seconds since the previous frame
+  double elapsed{};// seconds since the first frame
+  uint64_t frame{};
+};
+
+#endif// STABBY2D_TIMERESOURCE_HPP
@@ -0,0 +1,60 @@
+//
+// Created by chaku on 28/11/23.
+//
+
+#ifndef STABBY2D_SCENE_HPP
+#define STABBY2D_SCENE_HPP
+
+#include "ECS.hpp"
+#include "MapGenerator.hpp"
+#include "TileMap.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Synthetic load for scaling tests: moving sprites over a grid of static tiles, spread over a handful of
+// textures, with optional spawn/despawn churn
+struct StressSceneSettings {
+  uint32_t sprites{ 10000 };
+  uint32_t tiles{ 0 };
+  uint32_t textures{ 8 };// sprites and tiles cycle through StressTextureName(0 .. textures - 1)
+  double churnPerSecond{ 0.0 };// sprites despawned and respawned per second
+  uint64_t seed{ 1 };
+};
+
+// What goes into the world at startup. Scenes only create entities and resources, they never touch SDL, so the
+// windowed game and the headless runner build identical worlds from the same settings.
+struct SceneSettings {
+  struct ProceduralMap {
+    MapGeneratorSettings settings;
+    uint32_t chunksX;
+    uint32_t chunksY;
+  };
+  std::optional<ProceduralMap> proceduralMap;// generate the map instead of loading mapFile
+  std::string mapFile{ "./assets/tilemaps/jungle.map" };
+  std::string playerPrefab{ "./assets/prefabs/tank.prefab" };
+  std::optional<StressSceneSettings> stress;// replaces the tank and the map
+  uint32_t agents{ 0 };// added on top of either scene, see SpawnAgents
+};
+
+// @brief The default scene: the player tank and the tile map
+void LoadScene(Registry& registry, const SceneSettings& settings);
+
+// @brief One static sprite entity per tile plus the MapInfo resource
+void BuildTileMap(Registry& registry, const TileMap& tileMap);
+
+// @brief Sprites, tiles and, with churn, a StressChurnSystem (run by World::Step)
+void LoadStressScene(Registry& registry, const StressSceneSettings& settings);
+
+// @brief Agents that see each other (PerceptionComponent) and run a behaviour tree: flee from the nearest agent
+// in sight, wander otherwise. The tree is registered with the registry's BehaviourTreeSystem, which (like the
+// PerceptionSystem) has to exist already, World adds both.
+void SpawnAgents(Registry& registry, uint32_t count, uint64_t seed);
+
+// @brief Key of stress texture `index`, whoever renders the scene has to provide them
+std::string StressTextureName(uint32_t index);
+
+// @brief Parse "sprites[,tiles[,textures[,churnPerSecond]]]", e.g. "20000,4096,16,500"
+std::optional<StressSceneSettings> ParseStressSettings(std::string_view text);
+
+#endif// STABBY2D_SCENE_HPP
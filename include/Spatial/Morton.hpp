@@ -0,0 +1,32 @@
+//
+// Created by chaku on 20/11/23.
+//
+
+#ifndef STABBY2D_MORTON_HPP
+#define STABBY2D_MORTON_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+// @brief Spread the low 32 bits of v so there is a zero bit between each of them
+inline auto SpreadBits(uint64_t v) -> uint64_t {
+  v &= 0xFFFFFFFFULL;
+  v = (v | (v << 16U)) & 0x0000FFFF0000FFFFULL;
+  v = (v | (v << 8U)) & 0x00FF00FF00FF00FFULL;
+  v = (v | (v << 4U)) & 0x0F0F0F0F0F0F0F0FULL;
+  v = (v | (v << 2U)) & 0x3333333333333333ULL;
+  v = (v | (v << 1U)) & 0x5555555555555555ULL;
+  return v;
+}
+
+// @brief Z-order curve index of a world position, points close in space get close codes
+// @param cellSize positions are quantised to cells of this size first
+inline auto MortonCode(float x, float y, float cellSize = 32.0F) -> uint64_t {
+  // offset so that negative coordinates (up to 2^30 cells away) still sort correctly
+  constexpr int64_t bias = int64_t{ 1 } << 30;
+  const auto cellX = std::clamp<int64_t>(static_cast<int64_t>(x / cellSize) + bias, 0, 0xFFFFFFFF);
+  const auto cellY = std::clamp<int64_t>(static_cast<int64_t>(y / cellSize) + bias, 0, 0xFFFFFFFF);
+  return SpreadBits(static_cast<uint64_t>(cellX)) | (SpreadBits(static_cast<uint64_t>(cellY)) << 1U);
+}
+
+#endif// STABBY2D_MORTON_HPP
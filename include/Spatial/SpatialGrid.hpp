@@ -0,0 +1,120 @@
+//
+// Created by chaku on 05/11/23.
+//
+
+#ifndef STABBY2D_SPATIALGRID_HPP
+#define STABBY2D_SPATIALGRID_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over a set of points, rebuilt from scratch every frame.
+// Points are bucketed with a counting sort into one contiguous array (cell offsets + entries), so a query
+// only touches the few cells overlapping its radius and reads each cell as a linear run of memory.
+// The grid is read-only after Build(), so any number of threads may Query() concurrently.
+class SpatialGrid {
+public:
+  struct Entry {
+    float x;
+    float y;
+    uint32_t id;
+  };
+
+private:
+  float m_cellSize{ 64.0F };
+  float m_builtCellSize{ 64.0F };// m_cellSize, grown in Build() if the points are spread too thin
+  float m_minX{};
+  float m_minY{};
+  int32_t m_columns{};
+  int32_t m_rows{};
+  std::vector<uint32_t> m_cellStart;// m_cellStart[c]..m_cellStart[c + 1] are the entries of cell c
+  std::vector<Entry> m_entries;
+  std::vector<uint32_t> m_cellOfPoint;// scratch, kept to avoid reallocating every frame
+  std::vector<uint32_t> m_cursor;// scratch as well
+
+  auto CellCoord(float value, float min) const -> int32_t {
+    return static_cast<int32_t>(std::floor((value - min) / m_builtCellSize));
+  }
+
+public:
+  explicit SpatialGrid(float cellSize = 64.0F) : m_cellSize(cellSize) {}
+
+  auto SetCellSize(float cellSize) -> void { m_cellSize = std::max(cellSize, 1.0F); }
+
+  auto CellSize() const -> float { return m_cellSize; }
+
+  auto Size() const -> size_t { return m_entries.size(); }
+
+  // @brief Rebuild the grid around the given points, bounds are fitted to the points
+  auto Build(const std::vector<Entry>& points) -> void {
+    m_entries.resize(points.size());
+    if (points.empty()) {
+      m_columns = m_rows = 0;
+      m_cellStart.assign(1, 0);
+      return;
+    }
+
+    auto maxX = points.front().x;
+    auto maxY = points.front().y;
+    m_minX = points.front().x;
+    m_minY = points.front().y;
+    for (const auto& point : points) {
+      m_minX = std::min(m_minX, point.x);
+      m_minY = std::min(m_minY, point.y);
+      maxX = std::max(maxX, point.x);
+      maxY = std::max(maxY, point.y);
+    }
+    // keep the cell count proportional to the point count so sparse, far apart points can't blow up memory
+    const auto maxCells = static_cast<int64_t>(std::max<size_t>(points.size() * 4, 1024));
+    m_builtCellSize = m_cellSize;
+    for (;;) {
+      m_columns = CellCoord(maxX, m_minX) + 1;
+      m_rows = CellCoord(maxY, m_minY) + 1;
+      if (static_cast<int64_t>(m_columns) * m_rows <= maxCells) { break; }
+      m_builtCellSize *= 2.0F;
+    }
+
+    // counting sort by cell: count, exclusive prefix sum, scatter. Room for the most cells this point count
+    // allows, so points spreading out over time don't reallocate the cell arrays frame after frame.
+    m_cellStart.reserve(static_cast<size_t>(maxCells) + 1);
+    m_cursor.reserve(static_cast<size_t>(maxCells) + 1);
+    m_cellStart.assign(static_cast<size_t>(m_columns) * static_cast<size_t>(m_rows) + 1, 0);
+    m_cellOfPoint.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      const auto cell = static_cast<uint32_t>(CellCoord(points[i].y, m_minY) * m_columns + CellCoord(points[i].x, m_minX));
+      m_cellOfPoint[i] = cell;
+      ++m_cellStart[cell + 1];
+    }
+    for (size_t c = 1; c < m_cellStart.size(); ++c) { m_cellStart[c] += m_cellStart[c - 1]; }
+    m_cursor.assign(m_cellStart.begin(), m_cellStart.end());
+    for (size_t i = 0; i < points.size(); ++i) { m_entries[m_cursor[m_cellOfPoint[i]]++] = points[i]; }
+  }
+
+  // @brief Call fn(entry, distanceSquared) for every point within radius of (x, y)
+  template <typename TFunc>
+  auto Query(float x, float y, float radius, TFunc&& fn) const -> void {
+    if (m_entries.empty()) { return; }
+    const auto radiusSq = radius * radius;
+    const auto x0 = std::max(CellCoord(x - radius, m_minX), 0);
+    const auto y0 = std::max(CellCoord(y - radius, m_minY), 0);
+    const auto x1 = std::min(CellCoord(x + radius, m_minX), m_columns - 1);
+    const auto y1 = std::min(CellCoord(y + radius, m_minY), m_rows - 1);
+    for (auto cy = y0; cy <= y1; ++cy) {
+      const auto row = static_cast<size_t>(cy) * static_cast<size_t>(m_columns);
+      for (auto cx = x0; cx <= x1; ++cx) {
+        const auto cell = row + static_cast<size_t>(cx);
+        for (auto i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+          const auto& entry = m_entries[i];
+          const auto dx = entry.x - x;
+          const auto dy = entry.y - y;
+          const auto distSq = dx * dx + dy * dy;
+          if (distSq <= radiusSq) { fn(entry, distSq); }
+        }
+      }
+    }
+  }
+};
+
+#endif// STABBY2D_SPATIALGRID_HPP
@@ -0,0 +1,66 @@
+//
+// Created by chaku on 08/11/23.
+//
+
+#ifndef STABBY2D_BEHAVIOURTREESYSTEM_HPP
+#define STABBY2D_BEHAVIOURTREESYSTEM_HPP
+
+#include "BehaviourComponent.hpp"
+#include "BehaviourTree.hpp"
+#include "ECS.hpp"
+#include "TimeResource.hpp"
+
+// Ticks the behaviour tree of every entity with a BehaviourComponent.
+// Agents are bucketed by tree so every agent sharing a tree is ticked back to back while that tree's nodes
+// and action table are hot in cache.
+class BehaviourTreeSystem : public System {
+private:
+  std::vector<BehaviourTree> m_trees;
+  std::vector<uint32_t> m_batchStart;// agents of tree t are m_batched[m_batchStart[t]..m_batchStart[t + 1]]
+  std::vector<Entity> m_batched;
+  std::vector<uint32_t> m_cursor;
+
+public:
+  BehaviourTreeSystem() {
+    RequireComponent<BehaviourComponent>();
+    ReadsResource<TimeResource>();
+  }
+
+  // @brief Register a compiled tree
+  // @return id to store in BehaviourComponent::treeId
+  uint16_t AddTree(BehaviourTree tree) {
+    m_trees.emplace_back(std::move(tree));
+    return static_cast<uint16_t>(m_trees.size() - 1);
+  }
+
+  const BehaviourTree& GetTree(uint16_t treeId) const { return m_trees[treeId]; }
+
+  void Update() {
+    const auto deltaTime = GetResource<TimeResource>().deltaTime;
+    const auto entities = GetEntities();
+
+    // counting sort agents by tree id, unknown ids are skipped
+    m_batchStart.assign(m_trees.size() + 1, 0);
+    for (const auto& entity : entities) {
+      const auto treeId = entity.GetComponent<BehaviourComponent>().treeId;
+      if (treeId < m_trees.size()) { ++m_batchStart[treeId + 1]; }
+    }
+    for (size_t t = 1; t < m_batchStart.size(); ++t) { m_batchStart[t] += m_batchStart[t - 1]; }
+    m_batched.assign(m_batchStart.back(), Entity(0));
+    m_cursor.assign(m_batchStart.begin(), m_batchStart.end());
+    for (const auto& entity : entities) {
+      const auto treeId = entity.GetComponent<BehaviourComponent>().treeId;
+      if (treeId < m_trees.size()) { m_batched[m_cursor[treeId]++] = entity; }
+    }
+
+    for (size_t t = 0; t < m_trees.size(); ++t) {
+      const auto& tree = m_trees[t];
+      for (auto i = m_batchStart[t]; i < m_batchStart[t + 1]; ++i) {
+        auto& entity = m_batched[i];
+        tree.Tick(entity, entity.GetComponent<BehaviourComponent>(), deltaTime);
+      }
+    }
+  }
+};
+
+#endif// STABBY2D_BEHAVIOURTREESYSTEM_HPP
@@ -0,0 +1,163 @@
+//
+// Created by chaku on 01/12/23.
+//
+
+#ifndef STABBY2D_DEBUGOVERLAYSYSTEM_HPP
+#define STABBY2D_DEBUGOVERLAYSYSTEM_HPP
+
+#include "ECS.hpp"
+#include "FrameStats.hpp"
+#include "RenderContext.hpp"
+#include <SDL2/SDL.h>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <vector>
+
+// Frame time split (simulate / render / present), a rolling histogram of the last FrameStats::HISTORY frames,
+// per stage milliseconds and the FrameStats counters, drawn top left with one SDL_RenderGeometry call.
+// Text uses a built in 3x5 pixel font so the overlay needs no textures. Hidden until Toggle().
+class DebugOverlaySystem : public System {
+  static constexpr float PIXEL = 2.0F;
+  static constexpr float LINE_HEIGHT = 7.0F * PIXEL;
+  static constexpr float MARGIN = 8.0F;
+  static constexpr float PANEL_WIDTH = 44.0F * 4.0F * PIXEL;
+  static constexpr float BAR_WIDTH = 2.0F;
+  static constexpr float HISTOGRAM_HEIGHT = 64.0F;
+  static constexpr float HISTOGRAM_MS = 100.0F / 3.0F;// top of the histogram, two 60Hz frames
+  static constexpr float TARGET_MS = 1000.0F / 60.0F;
+
+  static constexpr SDL_Color PANEL{ 0, 0, 0, 180 };
+  static constexpr SDL_Color TEXT{ 230, 230, 230, 255 };
+  static constexpr SDL_Color SIMULATE{ 90, 200, 90, 255 };
+  static constexpr SDL_Color RENDER{ 90, 140, 230, 255 };
+  static constexpr SDL_Color PRESENT{ 220, 170, 60, 255 };
+  static constexpr SDL_Color TARGET{ 230, 60, 60, 255 };
+
+  // 5 rows of 3 bits per glyph, top row in the high bits, for "0-9", "A-Z" and ".:/-%"
+  static constexpr std::array<uint16_t, 41> FONT{
+    0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF, 0x2BED, 0x6BAE, 0x3923, 0x6B6E,
+    0x79A7, 0x79A4, 0x396B, 0x5BED, 0x7497, 0x126A, 0x5BAD, 0x4927, 0x5FED, 0x6B6D, 0x2B6A, 0x6BA4, 0x2B73, 0x6BAD,
+    0x388E, 0x7492, 0x5B6F, 0x5B6A, 0x5BFD, 0x5AAD, 0x5A92, 0x72A7, 0x0002, 0x0410, 0x12A4, 0x01C0, 0x52A5
+  };
+
+  bool m_visible{ false };
+  // rebuilt every frame, kept to reuse their capacity
+  std::vector<SDL_Vertex> m_vertices;
+  std::vector<int> m_indices;
+
+  static uint16_t Glyph(char character) {
+    const auto upper = static_cast<char>(std::toupper(static_cast<unsigned char>(character)));
+    if (upper >= '0' && upper <= '9') { return FONT[static_cast<size_t>(upper - '0')]; }
+    if (upper >= 'A' && upper <= 'Z') { return FONT[static_cast<size_t>(10 + upper - 'A')]; }
+    switch (upper) {
+      case '.': return FONT[36];
+      case ':': return FONT[37];
+      case '/': return FONT[38];
+      case '-': return FONT[39];
+      case '%': return FONT[40];
+      default: return 0;
+    }
+  }
+
+  void Quad(float x, float y, float width, float height, SDL_Color colour) {
+    const auto first = static_cast<int>(m_vertices.size());
+    m_vertices.push_back({ { x, y }, colour, { 0.0F, 0.0F } });
+    m_vertices.push_back({ { x + width, y }, colour, { 0.0F, 0.0F } });
+    m_vertices.push_back({ { x + width, y + height }, colour, { 0.0F, 0.0F } });
+    m_vertices.push_back({ { x, y + height }, colour, { 0.0F, 0.0F } });
+    for (const auto corner : { 0, 1, 2, 0, 2, 3 }) { m_indices.push_back(first + corner); }
+  }
+
+  // one quad per horizontal run of lit pixels
+  void Text(float x, float y, const char* text, SDL_Color colour) {
+    for (; *text != '\0'; ++text, x += 4.0F * PIXEL) {
+      const auto glyph = Glyph(*text);
+      for (int row = 0; row < 5; ++row) {
+        const auto bits = (glyph >> (3 * (4 - row))) & 0x7;
+        for (int column = 0; column < 3;) {
+          if ((bits & (4 >> column)) == 0) {
+            ++column;
+            continue;
+          }
+          int run = 1;
+          while (column + run < 3 && (bits & (4 >> (column + run))) != 0) { ++run; }
+          Quad(x + static_cast<float>(column) * PIXEL, y + static_cast<float>(row) * PIXEL,
+            static_cast<float>(run) * PIXEL, PIXEL, colour);
+          column += run;
+        }
+      }
+    }
+  }
+
+  template <typename... TArgs>
+  void Line(float x, float& y, SDL_Color colour, const char* format, TArgs... args) {
+    std::array<char, 64> buffer{};
+    std::snprintf(buffer.data(), buffer.size(), format, args...);
+    Text(x, y, buffer.data(), colour);
+    y += LINE_HEIGHT;
+  }
+
+  void Histogram(float x, float y, const FrameStats& stats) {
+    const auto scale = HISTOGRAM_HEIGHT / HISTOGRAM_MS;
+    const auto frames = stats.presentMs.Size();
+    for (size_t age = 0; age < frames; ++age) {
+      // newest frame on the right
+      const auto barX = x + static_cast<float>(FrameStats::HISTORY - 1 - age) * BAR_WIDTH;
+      auto barY = y + HISTOGRAM_HEIGHT;
+      for (const auto& [ring, colour] : { std::pair{ &stats.simulateMs, SIMULATE }, std::pair{ &stats.renderMs, RENDER },
+             std::pair{ &stats.presentMs, PRESENT } }) {
+        const auto height = std::min(ring->Recent(age) * scale, barY - y);
+        barY -= height;
+        Quad(barX, barY, BAR_WIDTH, height, colour);
+      }
+    }
+    Quad(x, y + HISTOGRAM_HEIGHT - TARGET_MS * scale, static_cast<float>(FrameStats::HISTORY) * BAR_WIDTH, 1.0F, TARGET);
+  }
+
+public:
+  DebugOverlaySystem() {
+    ReadsResource<RenderContext>();
+    ReadsResource<FrameStats>();
+  }
+
+  void Toggle() { m_visible = !m_visible; }
+  bool IsVisible() const { return m_visible; }
+
+  void Update() {
+    if (!m_visible) { return; }
+    const auto& renderer = GetResource<RenderContext>().renderer;
+    const auto& stats = GetResource<FrameStats>();
+    m_vertices.clear();
+    m_indices.clear();
+
+    const auto stages = std::min(stats.stageNames.size(), FrameStats::MAX_STAGES);
+    const auto height = static_cast<float>(5 + stages) * LINE_HEIGHT + HISTOGRAM_HEIGHT + 3.0F * MARGIN;
+    Quad(MARGIN, MARGIN, PANEL_WIDTH, height, PANEL);
+
+    const auto x = 2.0F * MARGIN;
+    auto y = 2.0F * MARGIN;
+    const auto simulate = stats.simulateMs.Mean();
+    const auto render = stats.renderMs.Mean();
+    const auto present = stats.presentMs.Mean();
+    const auto frame = simulate + render + present;
+    Line(x, y, TEXT, "FRAME %.2f MS  %.0f FPS", frame, frame > 0.0F ? 1000.0F / frame : 0.0F);
+    Line(x, y, SIMULATE, "SIMULATE %.2f", simulate);
+    Line(x, y, RENDER, "RENDER %.2f", render);
+    Line(x, y, PRESENT, "PRESENT %.2f", present);
+    for (size_t stage = 0; stage < stages; ++stage) {
+      if (stats.stageMs[stage].Size() == 0) { continue; }
+      Line(x + 2.0F * PIXEL * 4.0F, y, TEXT, "%-20.20s %.3f", stats.stageNames[stage], stats.stageMs[stage].Mean());
+    }
+    Line(x, y, TEXT, "ENTITIES %zu DRAWS %zu TEX %.1f MB", stats.entities.load(std::memory_order_relaxed),
+      stats.drawCalls.load(std::memory_order_relaxed),
+      static_cast<double>(stats.textureBytes.load(std::memory_order_relaxed)) / (1024.0 * 1024.0));
+    Histogram(x, y + MARGIN, stats);
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometry(renderer, nullptr, m_vertices.data(), static_cast<int>(m_vertices.size()), m_indices.data(),
+      static_cast<int>(m_indices.size()));
+  }
+};
+
+#endif// STABBY2D_DEBUGOVERLAYSYSTEM_HPP
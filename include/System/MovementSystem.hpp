@@ -7,6 +7,8 @@
 
 #include "ECS.hpp"
 #include "RigidBodyComponent.hpp"
+#include "Tags.hpp"
+#include "TimeResource.hpp"
 #include "TransformComponent.hpp"
 
 class MovementSystem : public System {
@@ -14,9 +16,12 @@ public:
   MovementSystem() {
     RequireComponent<TransformComponent>();
     RequireComponent<RigidBodyComponent>();
+    ExcludeComponent<StaticTag>();
+    ReadsResource<TimeResource>();
   }
 
-  void Update(const double deltaTime) {
+  void Update() {
+    const auto deltaTime = GetResource<TimeResource>().deltaTime;
     for(auto& entity : GetEntities()) {
       auto& transform = entity.GetComponent<TransformComponent>();
       auto& rigidBody = entity.GetComponent<RigidBodyComponent>();
@@ -0,0 +1,143 @@
+//
+// Created by chaku on 05/11/23.
+//
+
+#ifndef STABBY2D_PERCEPTIONSYSTEM_HPP
+#define STABBY2D_PERCEPTIONSYSTEM_HPP
+
+#include "ECS.hpp"
+#include "Morton.hpp"
+#include "ParallelFor.hpp"
+#include "PerceptionComponent.hpp"
+#include "SpatialGrid.hpp"
+#include "TransformComponent.hpp"
+#include <array>
+#include <span>
+
+// Finds, for every agent, the entities within its vision range.
+// Once per frame all perceivable entities are bucketed into a SpatialGrid, then the agents' queries run as one
+// batch spread over worker threads. Each agent owns a fixed slice of a flat result array, so workers never
+// share writes and reading the results is a single span lookup.
+class PerceptionSystem : public System {
+public:
+  static constexpr size_t MAX_TARGETS = 8;
+
+private:
+  static constexpr size_t AGENTS_PER_JOB = 256;
+  static constexpr uint32_t NO_SLOT = ~0U;
+
+  SpatialGrid m_grid;
+  std::vector<SpatialGrid::Entry> m_points;
+  std::vector<Entity> m_agents;
+  std::vector<float> m_ranges;
+  std::vector<Entity> m_targets;// MAX_TARGETS slots per agent, nearest first
+  std::vector<uint8_t> m_targetCounts;
+  std::vector<uint32_t> m_slotOfEntity;// entity id -> agent slot
+  uint32_t m_staggerFrames{ 1 };
+  uint64_t m_frame{};
+
+  auto Perceive(size_t slot) -> void {
+    const auto& agent = m_agents[slot];
+    const auto& self = m_points[slot];
+    std::array<std::pair<float, uint32_t>, MAX_TARGETS> nearest{};
+    size_t found = 0;
+
+    m_grid.Query(self.x, self.y, m_ranges[slot], [&](const SpatialGrid::Entry& entry, float distSq) {
+      if (entry.id == agent.GetId()) { return; }
+      // keep the MAX_TARGETS closest, insertion into a tiny sorted array
+      if (found == MAX_TARGETS && distSq >= nearest[MAX_TARGETS - 1].first) { return; }
+      auto pos = std::min(found, MAX_TARGETS - 1);
+      while (pos > 0 && nearest[pos - 1].first > distSq) {
+        nearest[pos] = nearest[pos - 1];
+        --pos;
+      }
+      nearest[pos] = { distSq, entry.id };
+      found = std::min(found + 1, MAX_TARGETS);
+    });
+
+    const auto base = slot * MAX_TARGETS;
+    for (size_t i = 0; i < found; ++i) {
+      Entity target(nearest[i].second);
+      target.registry = agent.registry;
+      m_targets[base + i] = target;
+    }
+    m_targetCounts[slot] = static_cast<uint8_t>(found);
+  }
+
+public:
+  PerceptionSystem() {
+    RequireComponent<TransformComponent>();
+    RequireComponent<PerceptionComponent>();
+    // agents next to each other in the list query the same grid cells, keeps those cells in cache
+    SetSortKey([](Entity& entity) {
+      const auto& position = entity.GetComponent<TransformComponent>().position;
+      return MortonCode(position.x, position.y);
+    }, true);
+  }
+
+  // @brief Spread agent updates over n frames, each agent is refreshed every n-th frame and keeps its
+  // previous targets in between. Positions in the index are always current.
+  void SetStaggerFrames(uint32_t frames) { m_staggerFrames = std::max(frames, 1U); }
+
+  // @brief Targets seen by the agent during its last update, nearest first
+  std::span<const Entity> GetTargets(const Entity& agent) const {
+    const auto id = agent.GetId();
+    if (id >= m_slotOfEntity.size() || m_slotOfEntity[id] == NO_SLOT) { return {}; }
+    const auto slot = m_slotOfEntity[id];
+    return { m_targets.data() + static_cast<size_t>(slot) * MAX_TARGETS, m_targetCounts[slot] };
+  }
+
+  void Update() {
+    const auto agents = GetEntities();
+    // slots follow the entity list, when it changed (new agents, locality sorting) carry the
+    // staggered results of every agent over to its new slot
+    if (!std::ranges::equal(agents, m_agents)) {
+      std::vector<Entity> targets(agents.size() * MAX_TARGETS, Entity(0));
+      std::vector<uint8_t> counts(agents.size(), 0);
+      for (size_t slot = 0; slot < agents.size(); ++slot) {
+        const auto id = agents[slot].GetId();
+        if (id >= m_slotOfEntity.size() || m_slotOfEntity[id] == NO_SLOT) { continue; }
+        const auto oldSlot = m_slotOfEntity[id];
+        counts[slot] = m_targetCounts[oldSlot];
+        std::copy_n(m_targets.begin() + static_cast<std::ptrdiff_t>(oldSlot * MAX_TARGETS), MAX_TARGETS,
+          targets.begin() + static_cast<std::ptrdiff_t>(slot * MAX_TARGETS));
+      }
+      m_targets = std::move(targets);
+      m_targetCounts = std::move(counts);
+    }
+    m_agents.assign(agents.begin(), agents.end());
+    const auto agentCount = m_agents.size();
+
+    // gather positions and ranges into flat arrays, slot i is m_agents[i]
+    m_points.resize(agentCount);
+    m_ranges.resize(agentCount);
+    float maxRange = 0.0F;
+    for (size_t slot = 0; slot < agentCount; ++slot) {
+      auto& entity = m_agents[slot];
+      const auto& transform = entity.GetComponent<TransformComponent>();
+      m_points[slot] = { transform.position.x, transform.position.y, entity.GetId() };
+      m_ranges[slot] = entity.GetComponent<PerceptionComponent>().visionRange;
+      maxRange = std::max(maxRange, m_ranges[slot]);
+    }
+    if (maxRange > 0.0F) { m_grid.SetCellSize(maxRange); }
+    m_grid.Build(m_points);
+
+    m_slotOfEntity.assign(m_slotOfEntity.size(), NO_SLOT);
+    for (size_t slot = 0; slot < agentCount; ++slot) {
+      const auto id = m_agents[slot].GetId();
+      if (id >= m_slotOfEntity.size()) { m_slotOfEntity.resize(id + 1, NO_SLOT); }
+      m_slotOfEntity[id] = static_cast<uint32_t>(slot);
+    }
+
+    const auto phase = m_frame++ % m_staggerFrames;
+    const auto jobs = (agentCount + AGENTS_PER_JOB - 1) / AGENTS_PER_JOB;
+    ParallelFor(jobs, [&](size_t job) {
+      const auto end = std::min(agentCount, (job + 1) * AGENTS_PER_JOB);
+      for (auto slot = job * AGENTS_PER_JOB; slot < end; ++slot) {
+        if (m_agents[slot].GetId() % m_staggerFrames == phase && m_ranges[slot] > 0.0F) { Perceive(slot); }
+      }
+    });
+  }
+};
+
+#endif// STABBY2D_PERCEPTIONSYSTEM_HPP
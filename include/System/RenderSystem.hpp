@@ -9,17 +9,23 @@
 #include "TransformComponent.hpp"
 #include "ECS.hpp"
 #include "AssetManager.hpp"
+#include "RenderContext.hpp"
 #include <SDL2/SDL.h>
 
 class RenderSystem : public System {
+  size_t m_drawCalls{ 0 };
+
 public:
   RenderSystem() {
     RequireComponent<TransformComponent>();
     RequireComponent<SpriteComponent>();
+    ReadsResource<RenderContext>();
   }
 
-  void Update(SDL_Renderer* renderer, std::unique_ptr<AssetManager>& assetManager)
+  void Update()
   {
+    const auto& [renderer, assetManager] = GetResource<RenderContext>();
+    m_drawCalls = 0;
     for (auto &entity : GetEntities()) {
       const auto transform = entity.GetComponent<TransformComponent>();
       const auto sprite = entity.GetComponent<SpriteComponent>();
@@ -39,8 +45,12 @@ public:
         transform.rotation,
         nullptr,
         SDL_FLIP_NONE);
+      ++m_drawCalls;
     }
   }
+
+  // @brief SDL_RenderCopyEx calls made by the last Update()
+  size_t GetDrawCalls() const { return m_drawCalls; }
 };
 
 #endif// STABBY2D_RENDERSYSTEM_HPP
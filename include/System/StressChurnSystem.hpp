@@ -0,0 +1,50 @@
+//
+// Created by chaku on 07/12/23.
+//
+
+#ifndef STABBY2D_STRESSCHURNSYSTEM_HPP
+#define STABBY2D_STRESSCHURNSYSTEM_HPP
+
+#include "ECS.hpp"
+#include "Tags.hpp"
+#include "TimeResource.hpp"
+#include <functional>
+
+// Despawns a run of ChurnTag entities and spawns as many replacements every frame, at a steady rate per
+// second, so the stress scene exercises entity creation, killing and ID reuse. The victims are a contiguous
+// run starting at a seeded random position, runs are deterministic for a given seed and timestep.
+class StressChurnSystem : public System {
+public:
+  using Spawner = std::function<void(Registry& registry)>;
+
+private:
+  double m_perSecond;
+  double m_pending{ 0.0 };
+  uint64_t m_state;
+  Spawner m_spawn;
+
+public:
+  StressChurnSystem(double perSecond, uint64_t seed, Spawner spawn)
+    : m_perSecond(perSecond), m_state(seed * 2654435761ULL + 1ULL), m_spawn(std::move(spawn)) {
+    RequireComponent<ChurnTag>();
+    ReadsResource<TimeResource>();
+  }
+
+  void Update() {
+    m_pending += m_perSecond * GetResource<TimeResource>().deltaTime;
+    const auto count = static_cast<size_t>(m_pending);
+    m_pending -= static_cast<double>(count);
+
+    const auto entities = GetEntities();
+    if (!entities.empty()) {
+      m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+      const auto start = static_cast<size_t>(m_state >> 33U) % entities.size();
+      for (size_t i = 0; i < std::min(count, entities.size()); ++i) {
+        entities[(start + i) % entities.size()].Kill();
+      }
+    }
+    for (size_t i = 0; i < count; ++i) { m_spawn(*registry); }
+  }
+};
+
+#endif// STABBY2D_STRESSCHURNSYSTEM_HPP
@@ -0,0 +1,67 @@
+//
+// Created by chaku on 22/11/23.
+//
+
+#ifndef STABBY2D_WORLD_HPP
+#define STABBY2D_WORLD_HPP
+
+#include "AssetManager.hpp"
+#include "ECS.hpp"
+#include <chrono>
+#include <memory>
+#include <span>
+
+// Notified around every stage of World::Step, e.g. to time the systems
+class StageObserver {
+public:
+  virtual ~StageObserver() = default;
+  virtual void BeginStage(size_t stage) = 0;
+  virtual void EndStage(size_t stage) = 0;
+};
+
+// A World is one isolated simulation: its own Registry, systems and resources. Worlds share nothing
+// mutable, so many of them can step on separate threads at once, all reading the same AssetManager.
+class World {
+private:
+  std::unique_ptr<Registry> m_registry{ std::make_unique<Registry>() };
+  std::shared_ptr<const AssetManager> m_assets;
+  std::chrono::microseconds m_localityBudget{ 250 };
+  StageObserver* m_stageObserver{ nullptr };
+
+  template <typename TFunc> void RunStage(size_t stage, TFunc&& fn);
+
+public:
+  // @brief Creates the world with the simulation systems (movement, perception, behaviour) and a TimeResource
+  explicit World(std::shared_ptr<const AssetManager> assets);
+
+  World(const World&) = delete;
+  World& operator=(const World&) = delete;
+  World(World&&) = default;
+  World& operator=(World&&) = default;
+  ~World() = default;
+
+  Registry& GetRegistry() { return *m_registry; }
+  const AssetManager& GetAssets() const { return *m_assets; }
+
+  // @brief Time per step spent on locality sorting, 0 disables it
+  void SetLocalityBudget(std::chrono::microseconds budget) { m_localityBudget = budget; }
+
+  // @brief Observer for the stages of Step(), nullptr for none. The observer must outlive its registration.
+  void SetStageObserver(StageObserver* observer) { m_stageObserver = observer; }
+  // @brief Names of the stages of Step() in execution order, indexed like StageObserver's stage argument
+  static std::span<const char* const> StageNames();
+
+  // @brief Advance the simulation by deltaTime seconds: time resource, pending entities, simulation systems
+  // (plus StressChurnSystem when the scene registered one)
+  void Step(double deltaTime);
+};
+
+// @brief Hash of everything the simulation produces (entity signatures, transforms, velocities), for checking
+// that two runs ended in the same state
+uint64_t HashWorldState(World& world);
+
+// @brief Step every world `frames` times with a fixed timestep, spreading worlds over worker threads.
+// Each world is stepped by exactly one thread for the whole run.
+void RunWorlds(std::span<World> worlds, uint64_t frames, double deltaTime);
+
+#endif// STABBY2D_WORLD_HPP
@@ -0,0 +1,84 @@
+//
+// Created by chaku on 08/11/23.
+//
+
+#include "BehaviourTree.hpp"
+#include "Logger.hpp"
+
+auto BehaviourTree::Evaluate(uint16_t index, int32_t resume, Entity& entity, BehaviourComponent& state,
+  double deltaTime) const -> BtStatus {
+  const auto& node = m_nodes[index];
+  switch (node.type) {
+    case BtNodeType::Action: {
+      const auto status = m_actions[node.action](entity, state.blackboard, deltaTime);
+      if (status == BtStatus::Running) { state.runningNode = index; }
+      return status;
+    }
+    case BtNodeType::Inverter: {
+      const auto status = Evaluate(static_cast<uint16_t>(index + 1), resume, entity, state, deltaTime);
+      if (status == BtStatus::Running) { return status; }
+      return status == BtStatus::Success ? BtStatus::Failure : BtStatus::Success;
+    }
+    case BtNodeType::Sequence:
+    case BtNodeType::Selector: {
+      // a sequence keeps going on success, a selector on failure
+      const auto proceed = node.type == BtNodeType::Sequence ? BtStatus::Success : BtStatus::Failure;
+      auto child = static_cast<uint16_t>(index + 1);
+      if (resume > index && resume < node.end) {
+        while (m_nodes[child].end <= resume) { child = m_nodes[child].end; }
+      }
+      for (; child < node.end; child = m_nodes[child].end) {
+        const auto status = Evaluate(child, resume, entity, state, deltaTime);
+        if (status != proceed) { return status; }
+      }
+      return proceed;
+    }
+  }
+  return BtStatus::Failure;
+}
+
+auto BehaviourTree::Tick(Entity& entity, BehaviourComponent& state, double deltaTime) const -> BtStatus {
+  if (m_nodes.empty()) { return BtStatus::Failure; }
+  const auto resume = state.runningNode;
+  state.runningNode = -1;
+  return Evaluate(0, resume, entity, state, deltaTime);
+}
+
+auto BehaviourTreeBuilder::Open(BtNodeType type) -> BehaviourTreeBuilder& {
+  m_open.push_back(static_cast<uint16_t>(m_nodes.size()));
+  m_nodes.push_back({ type, 0, 0 });
+  return *this;
+}
+
+auto BehaviourTreeBuilder::Action(BtAction action) -> BehaviourTreeBuilder& {
+  const auto index = static_cast<uint16_t>(m_nodes.size());
+  m_nodes.push_back({ BtNodeType::Action, static_cast<uint16_t>(index + 1), static_cast<uint16_t>(m_actions.size()) });
+  m_actions.push_back(action);
+  return *this;
+}
+
+auto BehaviourTreeBuilder::End() -> BehaviourTreeBuilder& {
+  if (m_open.empty()) {
+    LOG_ERROR("BehaviourTreeBuilder: End() without an open composite");
+    m_valid = false;
+    return *this;
+  }
+  const auto index = m_open.back();
+  m_open.pop_back();
+  auto& node = m_nodes[index];
+  node.end = static_cast<uint16_t>(m_nodes.size());
+  if (node.end == index + 1
+      || (node.type == BtNodeType::Inverter && m_nodes[index + 1].end != node.end)) {
+    LOG_ERROR("BehaviourTreeBuilder: composite {} has the wrong number of children", index);
+    m_valid = false;
+  }
+  return *this;
+}
+
+auto BehaviourTreeBuilder::Build() const -> BehaviourTree {
+  if (!m_valid || !m_open.empty() || m_nodes.empty()) {
+    LOG_ERROR("BehaviourTreeBuilder: malformed tree, building an empty tree instead");
+    return { {}, {} };
+  }
+  return { m_nodes, m_actions };
+}
@@ -4,33 +4,89 @@
 
 #include "AssetManager.hpp"
 #include "Logger.hpp"
+#include <mutex>
+
+namespace {
+size_t TextureBytes(SDL_Texture* texture) {
+  int width = 0;
+  int height = 0;
+  if (texture == nullptr || SDL_QueryTexture(texture, nullptr, nullptr, &width, &height) != 0) {
+    return 0;
+  }
+  return static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+}
+}// namespace
 
 void AssetManager::ClearAssets() {
+  std::unique_lock lock(texturesMutex);
   for(auto& texture : textures) {
     SDL_DestroyTexture(texture.second);
   }
   textures.clear();
+  textureBytes = 0;
 }
 
 void AssetManager::AddTexture(const std::string& name, const std::string& filePath, SDL_Renderer* renderer) {
-  SDL_Texture* value = nullptr;
+  if (SDL_Surface* loadedSurface = DecodeImage(filePath)) {
+    AddTexture(name, loadedSurface, renderer);
+  }
+}
 
+SDL_Surface* AssetManager::DecodeImage(const std::string& filePath) {
   SDL_Surface* loadedSurface = IMG_Load(filePath.c_str());
   if (loadedSurface == nullptr) {
-    Logger::Error("Could not load texture from " + filePath);
+    LOG_ERROR("Could not load texture from {}", filePath);
+    return nullptr;
+  }
+  LOG_INFO("Loaded texture from {}", filePath);
+  return loadedSurface;
+}
+
+void AssetManager::AddTexture(const std::string& name, SDL_Surface* surface, SDL_Renderer* renderer) {
+  SDL_Texture* value = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_FreeSurface(surface);
+  if (value == nullptr) {
+    LOG_ERROR("Could not create texture {} from surface", name);
     return;
   }
-  Logger::Info("Loaded texture from " + filePath);
-  value = SDL_CreateTextureFromSurface(renderer, loadedSurface);
+  LOG_INFO("Created texture {} from surface", name);
+  StoreTexture(name, value);
+}
+
+void AssetManager::AddSolidTexture(const std::string& name, int width, int height, SDL_Color colour, SDL_Renderer* renderer) {
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+  if (surface == nullptr) {
+    LOG_ERROR("Could not create surface for {}: {}", name, SDL_GetError());
+    return;
+  }
+  SDL_FillRect(surface, nullptr, SDL_MapRGBA(surface->format, colour.r, colour.g, colour.b, colour.a));
+  SDL_Texture* value = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_FreeSurface(surface);
   if (value == nullptr) {
-    Logger::Error("Could not create texture from surface " + filePath);
+    LOG_ERROR("Could not create texture {}: {}", name, SDL_GetError());
     return;
   }
-  Logger::Info("Created texture from surface " + filePath);
-  SDL_FreeSurface(loadedSurface);
-  textures[std::string(name)] = value;
+  StoreTexture(name, value);
+}
+
+void AssetManager::StoreTexture(const std::string& name, SDL_Texture* texture) {
+  std::unique_lock lock(texturesMutex);
+  auto& slot = textures[name];
+  if (slot != nullptr) {
+    textureBytes -= TextureBytes(slot);
+    SDL_DestroyTexture(slot);
+  }
+  slot = texture;
+  textureBytes += TextureBytes(texture);
+}
+
+SDL_Texture* AssetManager::GetTexture(const std::string& key) const {
+  std::shared_lock lock(texturesMutex);
+  const auto texture = textures.find(key);
+  return texture == textures.end() ? nullptr : texture->second;
 }
 
-SDL_Texture*&AssetManager::GetTexture(const std::string& key) {
-  return textures[key];
+size_t AssetManager::GetTextureBytes() const {
+  std::shared_lock lock(texturesMutex);
+  return textureBytes;
 }
\ No newline at end of file
@@ -1,11 +1,43 @@
 #include "ECS.hpp"
 #include "Logger.hpp"
+#include "Profiler.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+
+namespace {
+std::string Demangle(const std::type_info& type) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    std::string name = status == 0 && demangled != nullptr ? demangled : type.name();
+    std::free(demangled);
+    return name;
+}
+}// namespace
 
 unsigned int Entity::GetId() const { return m_entityId; }
 
+void System::SetTracked(const Entity& entity, bool tracked) {
+  const auto entityId = entity.GetId();
+  if (entityId >= m_tracked.size()) {
+    if (!tracked) { return; }
+    m_tracked.resize(entityId + 1, false);
+  }
+  m_tracked[entityId] = tracked;
+}
+
 void System::AddEntity(const Entity& entity) {
-  Logger::Info("Added entityId " + std::to_string(entity.GetId()) + " to system");
+  LOG_INFO("Added entityId {} to system", entity.GetId());
   m_entities.emplace_back(entity);
+  SetTracked(entity, true);
+  m_sortDirty = true;
+}
+
+void System::AddEntities(std::span<const Entity> entities) {
+  LOG_INFO("Added {} entities to system", entities.size());
+  m_entities.insert(m_entities.end(), entities.begin(), entities.end());
+  for (const auto& entity : entities) { SetTracked(entity, true); }
+  m_sortDirty = true;
 }
 
 void System::RemoveEntity(Entity &entity) {
@@ -14,43 +46,418 @@ void System::RemoveEntity(Entity &entity) {
     std::erase_if(m_entities, [&entity](Entity& other) {
         return other == entity;
     });
+    SetTracked(entity, false);
+    m_removedDuringSort = true;
 }
 
-std::vector<Entity> System::GetEntities() const{
+bool System::Tracks(const Entity& entity) const {
+    const auto entityId = entity.GetId();
+    return entityId < m_tracked.size() && m_tracked[entityId];
+}
+
+std::span<const Entity> System::GetEntities() const{
     return m_entities;
 }
 
+size_t System::GetEntityCount() const {
+    return m_entities.size();
+}
+
+void System::SetSortKey(SortKey key, bool continuous) {
+    m_sortKey = std::move(key);
+    m_resortContinuously = continuous;
+    m_sortDirty = true;
+    m_sortPhase = SortPhase::Idle;
+}
+
+bool System::SortEntities(Clock::time_point deadline) {
+    // checking the clock is not free, only do it every few keys while taking the snapshot
+    constexpr size_t keysPerClockCheck = 1024;
+    // sorted with std::sort in one step each, then merged
+    constexpr size_t runLength = 1024;
+    const auto byKey = [](const KeyedEntity& lhs, const KeyedEntity& rhs) {
+        return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+    };
+
+    if (m_sortPhase == SortPhase::Idle) {
+        if (!m_sortDirty && !m_resortContinuously) {
+            return true;
+        }
+        m_sortDirty = false;
+        m_removedDuringSort = false;
+        m_sortKeys.clear();
+        m_sortCursor = 0;
+        m_sortPhase = SortPhase::Snapshot;
+    }
+
+    while (Clock::now() < deadline) {
+        if (m_removedDuringSort) {
+            // the snapshot would resurrect removed entities
+            m_removedDuringSort = false;
+            m_sortKeys.clear();
+            m_sortCursor = 0;
+            m_sortPhase = SortPhase::Snapshot;
+        }
+        switch (m_sortPhase) {
+        case SortPhase::Snapshot: {
+            const auto end = std::min(m_entities.size(), m_sortKeys.size() + keysPerClockCheck);
+            for (auto i = m_sortKeys.size(); i < end; ++i) {
+                m_sortKeys.emplace_back(m_sortKey ? m_sortKey(m_entities[i]) : m_entities[i].GetId(), m_entities[i]);
+            }
+            if (m_sortKeys.size() == m_entities.size()) {
+                m_sortCursor = 0;
+                m_sortPhase = SortPhase::Runs;
+            }
+            break;
+        }
+        case SortPhase::Runs: {
+            const auto first = m_sortKeys.begin() + static_cast<std::ptrdiff_t>(m_sortCursor);
+            const auto count = std::min(runLength, m_sortKeys.size() - m_sortCursor);
+            std::sort(first, first + static_cast<std::ptrdiff_t>(count), byKey);
+            m_sortCursor += count;
+            if (m_sortCursor >= m_sortKeys.size()) {
+                m_sortCursor = 0;
+                m_sortWidth = runLength;
+                // same size as the keys, the contents are overwritten by the merges
+                m_sortMerged.assign(m_sortKeys.begin(), m_sortKeys.end());
+                m_sortPhase = SortPhase::Merge;
+            }
+            break;
+        }
+        case SortPhase::Merge: {
+            if (m_sortWidth >= m_sortKeys.size()) {
+                // sorted: write the order back, entities appended since the snapshot stay at the end
+                for (size_t i = 0; i < m_sortKeys.size(); ++i) {
+                    m_entities[i] = m_sortKeys[i].second;
+                }
+                m_sortPhase = SortPhase::Idle;
+                return true;
+            }
+            // one pair of neighbouring runs per step, the last run may have no partner and is copied
+            const auto size = m_sortKeys.size();
+            const auto middle = std::min(m_sortCursor + m_sortWidth, size);
+            const auto last = std::min(m_sortCursor + 2 * m_sortWidth, size);
+            const auto keys = m_sortKeys.begin();
+            std::merge(keys + static_cast<std::ptrdiff_t>(m_sortCursor), keys + static_cast<std::ptrdiff_t>(middle),
+                keys + static_cast<std::ptrdiff_t>(middle), keys + static_cast<std::ptrdiff_t>(last),
+                m_sortMerged.begin() + static_cast<std::ptrdiff_t>(m_sortCursor), byKey);
+            m_sortCursor = last;
+            if (m_sortCursor >= size) {
+                std::swap(m_sortKeys, m_sortMerged);
+                m_sortCursor = 0;
+                m_sortWidth *= 2;
+            }
+            break;
+        }
+        case SortPhase::Idle:
+            return true;
+        }
+    }
+    return false;
+}
+
 Signature const& System::GetComponentSignature() const {
     return m_componentSignature;
 }
 
+Signature const& System::GetExcludedSignature() const {
+    return m_excludedSignature;
+}
+
+bool System::Matches(const Signature& entitySignature) const {
+    return m_componentSignature.any() && (entitySignature & m_componentSignature) == m_componentSignature
+        && (entitySignature & m_excludedSignature).none();
+}
+
+void System::RemoveEntities(std::span<const Entity> entities) {
+    const auto removed = std::erase_if(m_entities, [entities](const Entity& entity) {
+        return std::binary_search(entities.begin(), entities.end(), entity);
+    });
+    for (const auto& entity : entities) { SetTracked(entity, false); }
+    m_removedDuringSort = m_removedDuringSort || removed > 0;
+}
+
 Entity Registry::CreateEntity() {
-    auto entityId = m_numEntities++;
+    size_t entityId = 0;
+    if (m_freeIds.empty()) {
+        entityId = m_numEntities++;
+    } else {
+        entityId = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
     Entity entity(entityId);
     entity.registry = this;
-    m_entitiesToBeAdded.insert(entity);
+    m_entitiesToBeAdded.push_back(entity);
 
     if (entityId >= m_entityComponentSignatures.size()) { m_entityComponentSignatures.resize(entityId + 1);
     }
-    Logger::Info("Entity created : " + std::to_string(entityId));
+    LOG_INFO("Entity created : {}", entityId);
     return entity;
 }
 
+std::vector<Entity> Registry::Instantiate(const Prefab& prefab, size_t count) {
+    std::vector<Entity> entities;
+    if (count == 0) {
+        return entities;
+    }
+    const auto first = m_numEntities;
+    m_numEntities += count;
+    entities.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Entity entity(first + i);
+        entity.registry = this;
+        entities.push_back(entity);
+    }
+
+    for (const auto& blueprint : prefab.m_components) {
+        if (blueprint.componentId >= m_componentPools.size()) {
+            m_componentPools.resize(blueprint.componentId + 1, nullptr);
+        }
+        auto& pool = m_componentPools[blueprint.componentId];
+        if (!pool) {
+            pool = blueprint.makePool();
+        }
+        blueprint.fill(*pool, blueprint.value.get(), first, count);
+    }
+
+    m_entityComponentSignatures.resize(m_numEntities);
+    std::fill_n(m_entityComponentSignatures.begin() + static_cast<std::ptrdiff_t>(first), count, prefab.GetSignature());
+    for (unsigned int componentId = 0; componentId < m_componentObservers.size(); ++componentId) {
+        if (prefab.GetSignature().test(componentId) && !m_componentObservers[componentId].onAdded.empty()) {
+            auto& added = m_componentObservers[componentId].added;
+            added.insert(added.end(), entities.begin(), entities.end());
+        }
+    }
+    m_batchesToBeAdded.push_back({ prefab.GetSignature(), entities });
+    LOG_INFO("Instantiated {} entities from prefab", count);
+    return entities;
+}
+
+ResourceSignature const& System::GetResourceReads() const {
+    return m_resourceReads;
+}
+
+ResourceSignature const& System::GetResourceWrites() const {
+    return m_resourceWrites;
+}
+
+bool System::ConflictsWith(const System& other) const {
+    return (m_resourceWrites & (other.m_resourceReads | other.m_resourceWrites)).any()
+        || (other.m_resourceWrites & m_resourceReads).any();
+}
+
+std::span<System* const> Registry::GetSystems() const {
+    return m_systemOrder;
+}
+
+Signature const& Registry::GetSignature(const Entity& entity) const {
+    return m_entityComponentSignatures[entity.GetId()];
+}
+
 void Registry::AddEntityToSystems(const Entity& entity) {
   const auto& entityComponentSignature = m_entityComponentSignatures[entity.GetId()];
 
     // Loop through all m_systems, add entity to the ones whose signature matches entityComponentSignature
-    for (const auto& system : m_systems) {
-      const auto& systemComponentSignature = system.second->GetComponentSignature();
-        if ((entityComponentSignature & systemComponentSignature) == systemComponentSignature) {
-            system.second->AddEntity(entity);
+    for (auto* system : m_systemOrder) {
+        if (system->Matches(entityComponentSignature)) {
+            system->AddEntity(entity);
         }
     }
 }
 
 void Registry::Update() {
+    PROFILE_SCOPE("Registry::Update");
     for(const auto& entity: m_entitiesToBeAdded) {
         AddEntityToSystems(entity);
     }
     m_entitiesToBeAdded.clear();
+
+    // every entity of a batch shares one signature, so match systems once per batch
+    for (const auto& batch : m_batchesToBeAdded) {
+        for (auto* system : m_systemOrder) {
+            if (system->Matches(batch.signature)) {
+                system->AddEntities(batch.entities);
+            }
+        }
+    }
+    m_batchesToBeAdded.clear();
+
+    if (!m_entitiesToBeKilled.empty()) {
+        std::sort(m_entitiesToBeKilled.begin(), m_entitiesToBeKilled.end());
+        m_entitiesToBeKilled.erase(std::unique(m_entitiesToBeKilled.begin(), m_entitiesToBeKilled.end()),
+            m_entitiesToBeKilled.end());
+        // only systems that track one of them pay for the removal pass
+        for (auto* system : m_systemOrder) {
+            const auto tracked = std::any_of(m_entitiesToBeKilled.begin(), m_entitiesToBeKilled.end(),
+                [system](const Entity& entity) { return system->Tracks(entity); });
+            if (tracked) {
+                system->RemoveEntities(m_entitiesToBeKilled);
+            }
+        }
+        for (const auto& entity : m_entitiesToBeKilled) {
+            auto& signature = m_entityComponentSignatures[entity.GetId()];
+            for (unsigned int componentId = 0; componentId < m_componentObservers.size(); ++componentId) {
+                if (signature.test(componentId)) {
+                    QueueComponentRemoved(componentId, entity);
+                }
+            }
+            signature.reset();
+            m_freeIds.push_back(entity.GetId());
+        }
+        m_entitiesToBeKilled.clear();
+    }
+
+    FlushComponentEvents();
+}
+
+void Registry::KillEntity(const Entity& entity) {
+    m_entitiesToBeKilled.push_back(entity);
+}
+
+void Registry::OptimizeLocality(std::chrono::microseconds budget) {
+    if (m_systemOrder.empty()) {
+        return;
+    }
+    const auto deadline = System::Clock::now() + budget;
+    for (size_t visited = 0; visited < m_systemOrder.size() && System::Clock::now() < deadline; ++visited) {
+        m_localityCursor %= m_systemOrder.size();
+        if (!m_systemOrder[m_localityCursor]->SortEntities(deadline)) {
+            // ran out of time, continue with the same system next frame
+            return;
+        }
+        ++m_localityCursor;
+    }
+}
+
+void Registry::AddComponentObserver(unsigned int componentId, bool onAdded, ComponentCallback callback) {
+    if (m_dispatchingComponentEvents) {
+        m_pendingObservers.push_back({ componentId, onAdded, std::move(callback) });
+        return;
+    }
+    if (componentId >= m_componentObservers.size()) {
+        m_componentObservers.resize(componentId + 1);
+    }
+    auto& observers = m_componentObservers[componentId];
+    (onAdded ? observers.onAdded : observers.onRemoved).push_back(std::move(callback));
+}
+
+void Registry::QueueComponentAdded(unsigned int componentId, const Entity& entity) {
+    if (componentId < m_componentObservers.size() && !m_componentObservers[componentId].onAdded.empty()) {
+        m_componentObservers[componentId].added.push_back(entity);
+    }
+}
+
+void Registry::QueueComponentRemoved(unsigned int componentId, const Entity& entity) {
+    if (componentId < m_componentObservers.size() && !m_componentObservers[componentId].onRemoved.empty()) {
+        m_componentObservers[componentId].removed.push_back(entity);
+    }
+}
+
+void Registry::FlushComponentEvents() {
+    // events are swapped into a scratch list first: callbacks may add or remove components themselves, those
+    // events go out in the next Update(). Observers they register are held back until dispatch is over and
+    // only see events from the next Update() on.
+    m_dispatchingComponentEvents = true;
+    for (size_t componentId = 0; componentId < m_componentObservers.size(); ++componentId) {
+        if (!m_componentObservers[componentId].added.empty()) {
+            std::swap(m_componentObservers[componentId].added, m_componentEventScratch);
+            for (size_t i = 0; i < m_componentObservers[componentId].onAdded.size(); ++i) {
+                m_componentObservers[componentId].onAdded[i](m_componentEventScratch);
+            }
+            m_componentEventScratch.clear();
+        }
+        if (!m_componentObservers[componentId].removed.empty()) {
+            std::swap(m_componentObservers[componentId].removed, m_componentEventScratch);
+            for (size_t i = 0; i < m_componentObservers[componentId].onRemoved.size(); ++i) {
+                m_componentObservers[componentId].onRemoved[i](m_componentEventScratch);
+            }
+            m_componentEventScratch.clear();
+        }
+    }
+    m_dispatchingComponentEvents = false;
+    for (auto& [componentId, onAdded, callback] : m_pendingObservers) {
+        AddComponentObserver(componentId, onAdded, std::move(callback));
+    }
+    m_pendingObservers.clear();
+}
+
+RegistryStats Registry::GetStats() const {
+    RegistryStats stats{};
+    stats.entities = m_numEntities;
+    stats.freeIds = m_freeIds.size();
+    stats.pendingEntities = m_entitiesToBeAdded.size();
+    for (const auto& batch : m_batchesToBeAdded) {
+        stats.pendingEntities += batch.entities.size();
+    }
+    stats.signatureCount = m_entityComponentSignatures.size();
+    stats.signatureBytes = m_entityComponentSignatures.capacity() * sizeof(Signature);
+
+    std::vector<size_t> live(m_componentPools.size(), 0);
+    for (const auto& signature : m_entityComponentSignatures) {
+        for (size_t componentId = 0; componentId < live.size(); ++componentId) {
+            live[componentId] += signature.test(componentId) ? 1 : 0;
+        }
+    }
+    for (size_t componentId = 0; componentId < m_componentPools.size(); ++componentId) {
+        const auto& pool = m_componentPools[componentId];
+        if (!pool) {
+            continue;
+        }
+        ComponentPoolStats poolStats{};
+        poolStats.componentId = static_cast<unsigned int>(componentId);
+        poolStats.name = Demangle(pool->ElementType());
+        poolStats.capacity = pool->SlotCapacity();
+        poolStats.slots = pool->SlotCount();
+        poolStats.live = live[componentId];
+        poolStats.bytes = poolStats.capacity * pool->ElementSize();
+        poolStats.fragmentation = poolStats.capacity == 0
+            ? 0.0 : 1.0 - static_cast<double>(poolStats.live) / static_cast<double>(poolStats.capacity);
+        stats.componentBytes += poolStats.bytes;
+        stats.pools.push_back(std::move(poolStats));
+    }
+    for (const auto* system : m_systemOrder) {
+        stats.systems.push_back({ Demangle(*system->type), system->GetEntityCount() });
+    }
+    return stats;
+}
+
+void Registry::LogStats() const {
+    const auto stats = GetStats();
+    LOG_REPORT("Registry: {} entities ({} pending, {} free IDs), signatures {} ({} bytes), components {} bytes",
+        stats.entities, stats.pendingEntities, stats.freeIds, stats.signatureCount, stats.signatureBytes, stats.componentBytes);
+    for (const auto& pool : stats.pools) {
+        LOG_REPORT("  pool {}: {} live / {} slots / {} capacity, {} bytes, {}% fragmented", pool.name, pool.live,
+            pool.slots, pool.capacity, pool.bytes, static_cast<int>(pool.fragmentation * 100.0));
+    }
+    for (const auto& system : stats.systems) {
+        LOG_REPORT("  system {}: {} entities", system.name, system.entities);
+    }
+}
+
+std::string ToJson(const RegistryStats& stats) {
+    std::string json;
+    auto append = [&json](const char* format, auto... args) {
+        const auto length = std::snprintf(nullptr, 0, format, args...);
+        const auto offset = json.size();
+        json.resize(offset + static_cast<size_t>(length) + 1);
+        std::snprintf(json.data() + offset, static_cast<size_t>(length) + 1, format, args...);
+        json.pop_back();
+    };
+    append("{\"entities\": %zu, \"free_ids\": %zu, \"pending_entities\": %zu, \"signature_count\": %zu, "
+           "\"signature_bytes\": %zu, \"component_bytes\": %zu, \"pools\": [", stats.entities, stats.freeIds,
+        stats.pendingEntities, stats.signatureCount,
+        stats.signatureBytes, stats.componentBytes);
+    for (size_t i = 0; i < stats.pools.size(); ++i) {
+        const auto& pool = stats.pools[i];
+        append("%s{\"id\": %u, \"name\": \"%s\", \"capacity\": %zu, \"slots\": %zu, \"live\": %zu, \"bytes\": %zu, "
+               "\"fragmentation\": %.4f}", i == 0 ? "" : ", ", pool.componentId, pool.name.c_str(), pool.capacity,
+            pool.slots, pool.live, pool.bytes, pool.fragmentation);
+    }
+    append("], \"systems\": [");
+    for (size_t i = 0; i < stats.systems.size(); ++i) {
+        append("%s{\"name\": \"%s\", \"entities\": %zu}", i == 0 ? "" : ", ", stats.systems[i].name.c_str(),
+            stats.systems[i].entities);
+    }
+    append("]}");
+    return json;
 }
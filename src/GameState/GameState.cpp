@@ -1,93 +1,128 @@
 #include "GameState.hpp"
-#include "MovementSystem.hpp"
+#include "DebugOverlaySystem.hpp"
+#include "Profiler.hpp"
+#include "RenderContext.hpp"
 #include "RenderSystem.hpp"
-#include "RigidBodyComponent.hpp"
-#include "SpriteComponent.hpp"
-#include "TransformComponent.hpp"
-#include <fstream>
-#include <sstream>
-void GameState::Initialize() {
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-        Logger::Error("Error Initializing SDL");
-        return;
-    }
+#include "StartupPipeline.hpp"
+#include <utility>
+#include <vector>
 
-    //SDL_DisplayMode displayMode;
-    window = SDL_CreateWindow(nullptr, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1920, 1080, SDL_WINDOW_BORDERLESS);
-    if (window == nullptr) {
-        Logger::Error("Error creating SDL window");
-        return;
-    }
+// how often the registry memory breakdown is written to the log
+constexpr uint64_t MILLISECS_PER_STATS_DUMP = 10000;
 
-    // SDL_RENDERER_ACCELERATED  - manually instruct SDL to try to use accelerated GPU
-    // SDL_RENDERER_PRESENTVSYNC - use VSync, i.e. sync frame rate with monitor's refresh rate. Enabling VSync will prevent some screen tearing artifacts
-    //                             when we display displaying our objects in our game loop, as it will try to synchronize the rendering of our frame with
-    //                             the refresh rate of the monitor.
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+namespace {
+struct ImageFile {
+  const char* name;
+  const char* path;
+};
+constexpr std::array<ImageFile, 2> sceneImages{ {
+  { "tank-right", "./assets/images/tank-panther-right.png" },
+  { "tilemap", "./assets/tilemaps/jungle.png" },
+} };
+}// namespace
 
-    if (renderer == nullptr) {
-        Logger::Error("Error creating SDL renderer");
-        return;
-    }
+void GameState::Initialize() {
+    PROFILE_SCOPE("Initialize");
+    startupBegin = std::chrono::steady_clock::now();
+    // the scene step below owns the registry until the pipeline is done, so systems go in first
+    Setup();
 
-    SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
+    using Thread = StartupPipeline::Thread;
+    StartupPipeline pipeline;
+    // decoded on a worker, uploaded on the main thread once the renderer exists
+    std::vector<std::pair<std::string, SDL_Surface*>> decodedImages;
 
-    isRunning = true;
+    // only what the game uses, SDL_INIT_EVERYTHING would also bring up audio, joysticks, haptics and controllers
+    const auto sdl = pipeline.Add("SDL_Init", Thread::Main, {}, [] {
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
+            LOG_ERROR("Error Initializing SDL: {}", SDL_GetError());
+            return false;
+        }
+        return true;
+    });
+
+    const auto createWindow = pipeline.Add("CreateWindow", Thread::Main, { sdl }, [this] {
+        //SDL_DisplayMode displayMode;
+        window = SDL_CreateWindow(nullptr, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1920, 1080, SDL_WINDOW_BORDERLESS);
+        if (window == nullptr) {
+            LOG_ERROR("Error creating SDL window");
+            return false;
+        }
+        return true;
+    });
+
+    const auto createRenderer = pipeline.Add("CreateRenderer", Thread::Main, { createWindow }, [this] {
+        // SDL_RENDERER_ACCELERATED  - manually instruct SDL to try to use accelerated GPU
+        // SDL_RENDERER_PRESENTVSYNC - use VSync, i.e. sync frame rate with monitor's refresh rate. Enabling VSync will prevent some screen tearing artifacts
+        //                             when we display displaying our objects in our game loop, as it will try to synchronize the rendering of our frame with
+        //                             the refresh rate of the monitor.
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        if (renderer == nullptr) {
+            LOG_ERROR("Error creating SDL renderer");
+            return false;
+        }
+        SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
+        return true;
+    });
+
+    // a missing image is logged and leaves its sprites untextured, as before, it doesn't stop the game.
+    // Waits for SDL_Init: SDL_image decodes through SDL (RWops, surfaces), which is initialised on the main thread.
+    const auto decodeImages = pipeline.Add("DecodeImages", Thread::Worker, { sdl }, [this, &decodedImages] {
+        if (sceneSettings.stress) { return true; }
+        for (const auto& [name, path] : sceneImages) {
+            if (SDL_Surface* surface = AssetManager::DecodeImage(path)) { decodedImages.emplace_back(name, surface); }
+        }
+        return true;
+    });
+
+    pipeline.Add("LoadScene", Thread::Worker, {}, [this] {
+        LoadScene(world.GetRegistry(), sceneSettings);
+        return true;
+    });
+
+    pipeline.Add("UploadTextures", Thread::Main, { createRenderer, decodeImages }, [this, &decodedImages] {
+        if (sceneSettings.stress) {
+            // spread the hues so neighbouring textures are distinguishable
+            for (uint32_t i = 0; i < sceneSettings.stress->textures; ++i) {
+                const auto hue = static_cast<Uint8>(i * 97U);
+                assetStore->AddSolidTexture(StressTextureName(i), 32, 32,
+                    SDL_Color{ hue, static_cast<Uint8>(255U - hue), static_cast<Uint8>(i * 53U), 255 }, renderer);
+            }
+        }
+        for (const auto& [name, surface] : decodedImages) { assetStore->AddTexture(name, surface, renderer); }
+        decodedImages.clear();
+        return true;
+    });
+
+    isRunning = pipeline.Run();
+    // left over when the renderer could not be created
+    for (const auto& [name, surface] : decodedImages) { SDL_FreeSurface(surface); }
+    world.GetRegistry().GetResource<RenderContext>().renderer = renderer;
+    pipeline.LogTimings();
 }
 
 void GameState::Setup() {
-  registry->AddSystem<MovementSystem>();
-  registry->AddSystem<RenderSystem>();
-
-  assetStore->AddTexture(std::string("tank-right"),std::string("./assets/images/tank-panther-right.png"), renderer);
-  assetStore->AddTexture("tilemap", "./assets/tilemaps/jungle.png", renderer);
-
-  constexpr int width{32};
-  constexpr int height{32};
-
-  // Create panther tank
-  auto tankRight = registry->CreateEntity();
-  tankRight.AddComponent<TransformComponent>(Position(10.0F, 30.0F), Scale(1.0F, 1.0F), Rotation(0.0));
-  tankRight.AddComponent<RigidBodyComponent>(Velocity(10.0F, 0.0F));
-  tankRight.AddComponent<SpriteComponent>("tank-right", width, height, SDL_Rect(0, 0, width, height));
-
-  // create tilemap
-  auto ConstructTileMap = [&, this]() {
-    const char delim{','};
-    const std::string fileName{"./assets/tilemaps/jungle.map"};
-    std::ifstream mapFile;
-    mapFile.open(fileName);
-    if (mapFile.fail()) {
-      mapFile.close();
-      Logger::Error("Could not open " + fileName);
-      return;
-    }
+  auto& registry = world.GetRegistry();
+  // the renderer is filled in once Initialize has created it
+  registry.SetResource<RenderContext>(nullptr, assetStore.get());
+  registry.AddSystem<RenderSystem>();
+  auto& frameStats = registry.SetResource<FrameStats>();
+  frameStats.stageNames = World::StageNames();
+  stageObserver.SetStats(&frameStats);
+  world.SetStageObserver(&stageObserver);
+  registry.AddSystem<DebugOverlaySystem>();
+}
 
-    // hardcode number of rows and number of columns for now
-    constexpr uint8_t tileSize{32};
-
-    uint8_t yPos = 0;
-    for(std::string line; std::getline(mapFile, line); ++yPos) {
-      std::string numStr;
-      std::stringstream ssLine(line);
-      uint8_t xPos = 0;
-      while(std::getline(ssLine, numStr, delim)) {
-        //Logger::Info(numStr);
-        const auto tileMapVal = std::stoi(numStr);
-        const auto xVal = (tileMapVal / 10) * tileSize;
-        const auto yVal = (tileMapVal % 10) * tileSize;
-        auto tile = registry->CreateEntity();
-        tile.AddComponent<TransformComponent>(Position(xPos * width * height, yPos * width * height), Scale(1.0F, 1.0F), Rotation(0.0F));
-        tile.AddComponent<SpriteComponent>("tilemap", width, height, SDL_Rect(xVal, yVal, width, height));
-        ++xPos;
-      }
-    }
-    mapFile.close();
-  };
-  ConstructTileMap();
+void GameState::UseProceduralMap(const MapGeneratorSettings& settings, uint32_t chunksX, uint32_t chunksY) {
+  sceneSettings.proceduralMap = SceneSettings::ProceduralMap{ settings, chunksX, chunksY };
+}
+
+void GameState::UseStressScene(const StressSceneSettings& settings) {
+  sceneSettings.stress = settings;
 }
 
 void GameState::ProcessInput() {
+    PROFILE_SCOPE("ProcessInput");
     SDL_Event event;
     while (SDL_PollEvent(&event) != 0) {
         switch (event.type) {
@@ -98,20 +133,50 @@ void GameState::ProcessInput() {
                 if (event.key.keysym.sym == SDLK_ESCAPE) {
                     isRunning = false;
                 }
+                if (event.key.keysym.sym == SDLK_F3 && event.key.repeat == 0) {
+                    world.GetRegistry().GetSystem<DebugOverlaySystem>().Toggle();
+                }
                 break;
             default:
-              Logger::Error("Received bad event");
+              LOG_ERROR("Received bad event {}", event.type);
               break;
         }
     }
 }
 
 void GameState::Render() {
+  PROFILE_SCOPE("Render");
+  using Clock = std::chrono::steady_clock;
+  const auto renderStart = Clock::now();
+  auto& registry = world.GetRegistry();
+  auto& frameStats = registry.GetResource<FrameStats>();
   SDL_SetRenderDrawColor(renderer, 21, 21, 21, 255);
   SDL_RenderClear(renderer);
 
-  registry->GetSystem<RenderSystem>().Update(renderer, assetStore);
-  SDL_RenderPresent(renderer);
+  {
+    PROFILE_SCOPE("RenderSystem");
+    auto& renderSystem = registry.GetSystem<RenderSystem>();
+    renderSystem.Update();
+    auto& overlay = registry.GetSystem<DebugOverlaySystem>();
+    overlay.Update();
+    frameStats.drawCalls.store(renderSystem.GetDrawCalls() + (overlay.IsVisible() ? 1 : 0), std::memory_order_relaxed);
+  }
+  const auto presentStart = Clock::now();
+  {
+    PROFILE_SCOPE("SDL_RenderPresent");
+    SDL_RenderPresent(renderer);
+  }
+  if (!firstFramePresented) {
+    firstFramePresented = true;
+    LOG_REPORT("Time to first frame: {} ms since Initialize",
+      std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startupBegin).count() / 1000.0);
+  }
+  // the overlay drawn this frame shows the previous frame's split
+  frameStats.simulateMs.Push(simulateMs);
+  frameStats.renderMs.Push(std::chrono::duration<float, std::milli>(presentStart - renderStart).count());
+  frameStats.presentMs.Push(std::chrono::duration<float, std::milli>(Clock::now() - presentStart).count());
+  frameStats.entities.store(registry.GetEntityCount(), std::memory_order_relaxed);
+  frameStats.textureBytes.store(assetStore->GetTextureBytes(), std::memory_order_relaxed);
 }
 
 
@@ -125,6 +190,7 @@ void GameState::Update() {
 
   auto timeToWait = MILLISECS_PER_FRAME - (SDL_GetTicks64() - milliSecsPrevFrame);
   if (timeToWait > 0 && timeToWait <= MILLISECS_PER_FRAME) {
+      PROFILE_SCOPE("FrameCap");
       SDL_Delay(timeToWait);
   }
 
@@ -132,22 +198,31 @@ void GameState::Update() {
   // Time since last frame in seconds
   auto deltaTime = static_cast<double>((SDL_GetTicks64() - milliSecsPrevFrame)) / updateInterval;
   milliSecsPrevFrame = SDL_GetTicks64();
-  registry->Update();
-  registry->GetSystem<MovementSystem>().Update(deltaTime);
+  PROFILE_SCOPE("Update");
+  const auto simulateStart = std::chrono::steady_clock::now();
+  world.Step(deltaTime);
+  simulateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - simulateStart).count();
+
+  if (milliSecsPrevFrame - milliSecsPrevStats >= MILLISECS_PER_STATS_DUMP) {
+    milliSecsPrevStats = milliSecsPrevFrame;
+    world.GetRegistry().LogStats();
+  }
 }
 
 void GameState::Run() {
-    Logger::Info("Game starting");
-    Setup();
+    LOG_INFO("Game starting");
     while(isRunning) {
+        PROFILE_FRAME();
         ProcessInput();
         Update();
         Render();
     }
-    Logger::Info("Game ended");
+    LOG_INFO("Game ended");
 };
 
 void GameState::Destroy() {
+    // textures belong to the renderer, release them before it goes away
+    assetStore->ClearAssets();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
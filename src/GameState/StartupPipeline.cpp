@@ -0,0 +1,112 @@
+//
+// Created by chaku on 09/12/23.
+//
+
+#include "StartupPipeline.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+// milliseconds rounded to 0.1 for the log
+double Milliseconds(std::chrono::steady_clock::duration duration) {
+  return std::round(std::chrono::duration<double, std::milli>(duration).count() * 10.0) / 10.0;
+}
+}// namespace
+
+size_t StartupPipeline::Add(std::string name, Thread thread, std::vector<size_t> dependencies, Step step) {
+  const auto index = m_nodes.size();
+  std::erase_if(dependencies, [index, &name](size_t dependency) {
+    if (dependency < index) { return false; }
+    LOG_ERROR("Startup step {} depends on step {} which is not added yet, ignoring it", name, dependency);
+    return true;
+  });
+  m_nodes.push_back({ std::move(name), thread, std::move(dependencies), std::move(step) });
+  return index;
+}
+
+size_t StartupPipeline::Advance(std::vector<std::jthread>& workers) {
+  size_t readyMain = m_nodes.size();
+  // a single pass suffices, dependencies always come first
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    auto& node = m_nodes[i];
+    if (node.state != State::Pending) { continue; }
+    const auto blocked = std::ranges::any_of(node.dependencies, [this](size_t dependency) {
+      return m_nodes[dependency].state == State::Failed || m_nodes[dependency].state == State::Skipped;
+    });
+    if (blocked) {
+      node.state = State::Skipped;
+      continue;
+    }
+    const auto ready = std::ranges::all_of(node.dependencies,
+      [this](size_t dependency) { return m_nodes[dependency].state == State::Succeeded; });
+    if (!ready) { continue; }
+    if (node.thread == Thread::Main) {
+      readyMain = std::min(readyMain, i);
+      continue;
+    }
+    node.state = State::Running;
+    node.started = Clock::now();
+    workers.emplace_back([this, i] { Finish(i, m_nodes[i].step()); });
+  }
+  return readyMain;
+}
+
+bool StartupPipeline::Finished() const {
+  return std::ranges::none_of(m_nodes,
+    [](const Node& node) { return node.state == State::Pending || node.state == State::Running; });
+}
+
+void StartupPipeline::Finish(size_t index, bool succeeded) {
+  {
+    std::lock_guard lock(m_mutex);
+    m_nodes[index].ended = Clock::now();
+    m_nodes[index].state = succeeded ? State::Succeeded : State::Failed;
+  }
+  m_changed.notify_all();
+}
+
+bool StartupPipeline::Run() {
+  m_started = Clock::now();
+  std::vector<std::jthread> workers;
+  {
+    std::unique_lock lock(m_mutex);
+    while (!Finished()) {
+      const auto index = Advance(workers);
+      if (index == m_nodes.size()) {
+        m_changed.wait(lock);
+        continue;
+      }
+      m_nodes[index].state = State::Running;
+      m_nodes[index].started = Clock::now();
+      lock.unlock();
+      const auto succeeded = m_nodes[index].step();
+      lock.lock();
+      m_nodes[index].ended = Clock::now();
+      m_nodes[index].state = succeeded ? State::Succeeded : State::Failed;
+    }
+  }
+  workers.clear();
+  return std::ranges::none_of(m_nodes, [](const Node& node) { return node.state == State::Failed; });
+}
+
+void StartupPipeline::LogTimings() const {
+  auto ended = m_started;
+  for (const auto& node : m_nodes) {
+    ended = std::max(ended, node.ended);
+    const char* const thread = node.thread == Thread::Main ? "main" : "worker";
+    switch (node.state) {
+    case State::Succeeded:
+    case State::Failed:
+      LOG_REPORT("Startup {} ({}): {} ms -> {} ms, took {} ms{}", node.name, thread,
+        Milliseconds(node.started - m_started), Milliseconds(node.ended - m_started), Milliseconds(node.ended - node.started),
+        node.state == State::Failed ? ", FAILED" : "");
+      break;
+    default:
+      LOG_WARN("Startup {} ({}): skipped", node.name, thread);
+      break;
+    }
+  }
+  LOG_REPORT("Startup pipeline took {} ms", Milliseconds(ended - m_started));
+}
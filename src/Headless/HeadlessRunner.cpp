@@ -0,0 +1,338 @@
+//
+// Created by chaku on 28/11/23.
+//
+
+// Runs the simulation without a window: loads the scene, steps the world a fixed number of frames with a fixed
+// timestep and reports per-stage timing percentiles plus a hash of the final state. Two runs with the same
+// arguments must print the same hash. The json report also carries a registry memory snapshot.
+// Built with STABBY2D_ALLOC_TRACKING it also counts heap allocations per frame after the warmup frames, and
+// --max-allocs fails the run (exit code 2) when a steady state frame allocates more than that.
+// --perf adds hardware counters per stage (Linux perf_event_open), skipped with a warning when unavailable.
+// They count the main thread only, see PerfCounters.
+// --stress replaces the scene with a generated one (see ParseStressSettings), --stress-sweep instead runs the
+// stress scene at 1000, 2000, 4000 ... sprites up to the given count and prints the frame time of each, a
+// scaling curve of entities against frame time. --agents adds perceiving, behaviour tree driven agents to
+// either scene (see SpawnAgents).
+// Usage: stabby2d_headless [--frames <n>] [--dt <seconds>] [--procedural-map <seed>] [--trace <file>]
+//                          [--json <file>] [--warmup <frames>] [--max-allocs <n>] [--perf]
+//                          [--stress <sprites[,tiles[,textures[,churn]]]>] [--stress-sweep <max sprites>]
+//                          [--agents <n>]
+
+#include "AllocTracker.hpp"
+#include "Logger.hpp"
+#include "PerfCounters.hpp"
+#include "Profiler.hpp"
+#include "Scene.hpp"
+#include "World.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+// Keeps the duration of every stage of every frame, percentiles need them all. With counters it also sums
+// their deltas per stage; they are read outside the timed region so the syscalls don't show up in the times.
+class StageTimer : public StageObserver {
+  using Clock = std::chrono::steady_clock;
+  std::vector<Clock::time_point> m_started;
+  const PerfCounters* m_counters;
+  std::vector<PerfSample> m_startCounts;
+
+public:
+  std::vector<std::vector<double>> microseconds;
+  std::vector<PerfSample> counterTotals;
+
+  StageTimer(size_t frames, const PerfCounters* counters)
+    : m_started(World::StageNames().size()), m_counters(counters), m_startCounts(World::StageNames().size()),
+      microseconds(World::StageNames().size()), counterTotals(World::StageNames().size()) {
+    for (auto& samples : microseconds) { samples.reserve(frames); }
+  }
+
+  void BeginStage(size_t stage) override {
+    if (m_counters != nullptr) { m_startCounts[stage] = m_counters->Read(); }
+    m_started[stage] = Clock::now();
+  }
+  void EndStage(size_t stage) override {
+    microseconds[stage].push_back(std::chrono::duration<double, std::micro>(Clock::now() - m_started[stage]).count());
+    if (m_counters != nullptr) {
+      const auto delta = m_counters->Read() - m_startCounts[stage];
+      for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) { counterTotals[stage].values[i] += delta.values[i]; }
+    }
+  }
+};
+
+struct Percentiles {
+  double p50{};
+  double p90{};
+  double p99{};
+  double max{};
+  double mean{};
+};
+
+Percentiles Summarise(std::vector<double> samples) {
+  if (samples.empty()) { return {}; }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double quantile) {
+    return samples[std::min(samples.size() - 1, static_cast<size_t>(quantile * static_cast<double>(samples.size())))];
+  };
+  double sum = 0.0;
+  for (const auto sample : samples) { sum += sample; }
+  return { at(0.50), at(0.90), at(0.99), samples.back(), sum / static_cast<double>(samples.size()) };
+}
+
+struct StageRow {
+  std::string name;
+  Percentiles times;
+  std::optional<std::array<double, PERF_EVENT_COUNT>> countersPerFrame;
+};
+
+struct SweepPoint {
+  uint32_t sprites;
+  size_t entities;
+  Percentiles frame;
+};
+
+// One fresh world per point so pools, systems and the locality order don't carry over between sizes.
+// Warmup frames are stepped but not timed.
+std::vector<SweepPoint> RunStressSweep(StressSceneSettings settings, uint32_t maxSprites, uint64_t frames,
+  uint64_t warmupFrames, double deltaTime) {
+  std::vector<SweepPoint> points;
+  for (uint32_t sprites = std::min(1000U, maxSprites); sprites > 0;
+       sprites = sprites == maxSprites ? 0 : std::min(sprites * 2, maxSprites)) {
+    settings.sprites = sprites;
+    World world(std::make_shared<const AssetManager>());
+    LoadStressScene(world.GetRegistry(), settings);
+    world.SetLocalityBudget(std::chrono::microseconds(0));
+    for (uint64_t frame = 0; frame < warmupFrames; ++frame) { world.Step(deltaTime); }
+    std::vector<double> frameMicroseconds;
+    frameMicroseconds.reserve(frames);
+    for (uint64_t frame = 0; frame < frames; ++frame) {
+      const auto frameStart = std::chrono::steady_clock::now();
+      world.Step(deltaTime);
+      frameMicroseconds.push_back(
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frameStart).count());
+    }
+    points.push_back({ sprites, world.GetRegistry().GetLiveEntityCount(), Summarise(std::move(frameMicroseconds)) });
+  }
+  return points;
+}
+
+int ReportStressSweep(const std::vector<SweepPoint>& points, const std::string& jsonFile) {
+  std::printf("%10s %10s %10s %10s %10s %12s\n", "sprites", "entities", "mean us", "p50 us", "p99 us", "ns/entity");
+  for (const auto& [sprites, entities, frame] : points) {
+    std::printf("%10u %10zu %10.2f %10.2f %10.2f %12.2f\n", sprites, entities, frame.mean, frame.p50, frame.p99,
+      entities > 0 ? frame.mean * 1000.0 / static_cast<double>(entities) : 0.0);
+  }
+  if (jsonFile.empty()) { return 0; }
+  std::FILE* file = std::fopen(jsonFile.c_str(), "w");
+  if (file == nullptr) {
+    std::fprintf(stderr, "could not write %s\n", jsonFile.c_str());
+    return 1;
+  }
+  std::fputs("{\n  \"sweep\": [", file);
+  for (size_t i = 0; i < points.size(); ++i) {
+    const auto& [sprites, entities, frame] = points[i];
+    std::fprintf(file, "%s\n    {\"sprites\": %u, \"entities\": %zu, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f}",
+      i == 0 ? "" : ",", sprites, entities, frame.mean, frame.p50, frame.p99);
+  }
+  std::fputs("\n  ]\n}\n", file);
+  std::fclose(file);
+  return 0;
+}
+}// namespace
+
+int main(int argc, char* argv[]) {
+  uint64_t frames = 1000;
+  double deltaTime = 1.0 / 60.0;
+  SceneSettings scene;
+  std::string traceFile;
+  std::string jsonFile;
+  uint64_t warmupFrames = 60;
+  std::optional<uint64_t> maxAllocations;
+  bool perf = false;
+  std::optional<uint32_t> sweepSprites;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--perf") == 0) { perf = true; }
+    else if (i + 1 == argc) { break; }
+    else if (std::strcmp(argv[i], "--frames") == 0) { frames = std::stoull(argv[++i]); }
+    else if (std::strcmp(argv[i], "--dt") == 0) { deltaTime = std::stod(argv[++i]); }
+    else if (std::strcmp(argv[i], "--procedural-map") == 0) {
+      MapGeneratorSettings settings;
+      settings.seed = std::stoull(argv[++i]);
+      scene.proceduralMap = SceneSettings::ProceduralMap{ settings, 8, 8 };
+    }
+    else if (std::strcmp(argv[i], "--trace") == 0) { traceFile = argv[++i]; }
+    else if (std::strcmp(argv[i], "--json") == 0) { jsonFile = argv[++i]; }
+    else if (std::strcmp(argv[i], "--warmup") == 0) { warmupFrames = std::stoull(argv[++i]); }
+    else if (std::strcmp(argv[i], "--max-allocs") == 0) { maxAllocations = std::stoull(argv[++i]); }
+    else if (std::strcmp(argv[i], "--stress") == 0) {
+      scene.stress = ParseStressSettings(argv[++i]);
+      if (!scene.stress) { return 1; }
+    }
+    else if (std::strcmp(argv[i], "--stress-sweep") == 0) { sweepSprites = static_cast<uint32_t>(std::stoul(argv[++i])); }
+    else if (std::strcmp(argv[i], "--agents") == 0) { scene.agents = static_cast<uint32_t>(std::stoul(argv[++i])); }
+  }
+
+  Logger::StartAsync();
+  if (sweepSprites) {
+    const auto points = RunStressSweep(scene.stress.value_or(StressSceneSettings{}), *sweepSprites, frames, warmupFrames, deltaTime);
+    Logger::Stop();
+    return ReportStressSweep(points, jsonFile);
+  }
+  World world(std::make_shared<const AssetManager>());
+  LoadScene(world.GetRegistry(), scene);
+  // locality sorting works against a wall clock budget, which would make the entity order (and so the
+  // floating point summation order) depend on machine speed
+  world.SetLocalityBudget(std::chrono::microseconds(0));
+
+  PerfCounters perfCounters;
+  if (perf && !perfCounters.Open()) {
+    LOG_WARN("Hardware counters unavailable ({}), reporting times only", perfCounters.Error());
+    perf = false;
+  } else if (perf && !perfCounters.Error().empty()) {
+    LOG_WARN("Some hardware counters unavailable ({}), they read 0", perfCounters.Error());
+  }
+  StageTimer timer(frames, perf ? &perfCounters : nullptr);
+  world.SetStageObserver(&timer);
+  std::vector<double> frameMicroseconds;
+  frameMicroseconds.reserve(frames);
+  if (!traceFile.empty()) {
+    if (!Profiler::IsCompiledIn()) { LOG_WARN("Built without STABBY2D_PROFILING, {} will contain no zones", traceFile); }
+    Profiler::StartCapture(frames);
+  }
+  if (maxAllocations && !AllocTracker::IsCompiledIn()) {
+    LOG_WARN("Built without STABBY2D_ALLOC_TRACKING, --max-allocs can't be checked");
+  }
+  uint64_t steadyAllocations = 0;
+  uint64_t maxFrameAllocations = 0;
+  uint64_t worstFrame = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t frame = 0; frame < frames; ++frame) {
+    PROFILE_FRAME();
+    if (frame == warmupFrames && maxAllocations) {
+      // every steady state allocation is a failure, keep where they all came from
+      AllocTracker::ClearSamples();
+      AllocTracker::SetSampleInterval(1);
+    }
+    const auto allocationsBefore = AllocTracker::Total().allocations;
+    const auto frameStart = std::chrono::steady_clock::now();
+    world.Step(deltaTime);
+    frameMicroseconds.push_back(
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frameStart).count());
+    const auto frameAllocations = AllocTracker::Total().allocations - allocationsBefore;
+    if (frame >= warmupFrames) {
+      steadyAllocations += frameAllocations;
+      if (frameAllocations > maxFrameAllocations) {
+        maxFrameAllocations = frameAllocations;
+        worstFrame = frame;
+      }
+    }
+  }
+  AllocTracker::SetSampleInterval(0);
+  PROFILE_FRAME();
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  world.SetStageObserver(nullptr);
+  const auto hash = HashWorldState(world);
+  const auto registryStats = world.GetRegistry().GetStats();
+  world.GetRegistry().LogStats();
+  Logger::Stop();
+
+  if (!traceFile.empty() && !Profiler::WriteChromeTrace(traceFile)) {
+    std::fprintf(stderr, "could not write %s\n", traceFile.c_str());
+  }
+
+  std::printf("%llu frames, dt %.6f s, %zu entities, %.3f s wall\n", static_cast<unsigned long long>(frames), deltaTime,
+    world.GetRegistry().GetLiveEntityCount(), elapsed.count());
+  std::printf("%-28s %10s %10s %10s %10s %10s\n", "stage (us)", "mean", "p50", "p90", "p99", "max");
+  std::vector<StageRow> rows;
+  for (size_t stage = 0; stage < timer.microseconds.size(); ++stage) {
+    if (timer.microseconds[stage].empty()) { continue; }
+    StageRow row{ World::StageNames()[stage], {}, std::nullopt };
+    if (perf) {
+      const auto stageFrames = static_cast<double>(timer.microseconds[stage].size());
+      row.countersPerFrame.emplace();
+      for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        (*row.countersPerFrame)[i] = static_cast<double>(timer.counterTotals[stage].values[i]) / stageFrames;
+      }
+    }
+    row.times = Summarise(std::move(timer.microseconds[stage]));
+    rows.push_back(std::move(row));
+  }
+  rows.push_back({ "frame", Summarise(std::move(frameMicroseconds)), std::nullopt });
+  for (const auto& [name, stats, counters] : rows) {
+    std::printf("%-28s %10.2f %10.2f %10.2f %10.2f %10.2f\n", name.c_str(), stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+  }
+  if (perf) {
+    std::printf("%-28s %12s %12s %6s %10s %10s %10s\n", "stage (per frame)", "cycles", "instructions", "ipc", "l1d miss",
+      "llc miss", "br miss");
+    for (const auto& [name, stats, counters] : rows) {
+      if (!counters) { continue; }
+      const auto& c = *counters;
+      const auto cycles = c[static_cast<size_t>(PerfEvent::Cycles)];
+      std::printf("%-28s %12.0f %12.0f %6.2f %10.0f %10.0f %10.0f\n", name.c_str(), cycles,
+        c[static_cast<size_t>(PerfEvent::Instructions)],
+        cycles > 0.0 ? c[static_cast<size_t>(PerfEvent::Instructions)] / cycles : 0.0,
+        c[static_cast<size_t>(PerfEvent::L1DMisses)], c[static_cast<size_t>(PerfEvent::LLCMisses)],
+        c[static_cast<size_t>(PerfEvent::BranchMisses)]);
+    }
+  }
+  std::printf("state hash %016llx\n", static_cast<unsigned long long>(hash));
+  if (AllocTracker::IsCompiledIn()) {
+    std::printf("steady state allocations (after %llu warmup frames): %llu total, worst frame %llu with %llu\n",
+      static_cast<unsigned long long>(warmupFrames), static_cast<unsigned long long>(steadyAllocations),
+      static_cast<unsigned long long>(worstFrame), static_cast<unsigned long long>(maxFrameAllocations));
+  }
+  const bool overAllocationBudget =
+    AllocTracker::IsCompiledIn() && maxAllocations && maxFrameAllocations > *maxAllocations;
+  if (overAllocationBudget) {
+    std::printf("FAILED: more than %llu allocations in a steady state frame, most frequent call stacks:\n",
+      static_cast<unsigned long long>(*maxAllocations));
+    for (const auto& site : AllocTracker::TopSites(10)) {
+      std::printf("  %llu allocations, %llu bytes\n", static_cast<unsigned long long>(site.allocations),
+        static_cast<unsigned long long>(site.bytes));
+      for (const auto& frame : site.frames) { std::printf("    %s\n", frame.c_str()); }
+    }
+  }
+
+  if (!jsonFile.empty()) {
+    std::FILE* file = std::fopen(jsonFile.c_str(), "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "could not write %s\n", jsonFile.c_str());
+      return 1;
+    }
+    std::fprintf(file, "{\n  \"frames\": %llu,\n  \"dt\": %.9f,\n  \"state_hash\": \"%016llx\",\n  \"stages\": [",
+      static_cast<unsigned long long>(frames), deltaTime, static_cast<unsigned long long>(hash));
+    for (size_t i = 0; i < rows.size(); ++i) {
+      const auto& [name, stats, counters] = rows[i];
+      std::fprintf(file, "%s\n    {\"name\": \"%s\", \"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f",
+        i == 0 ? "" : ",", name.c_str(), stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+      if (counters) {
+        // per frame means, counters that couldn't be opened are left out
+        std::fputs(", \"counters\": {", file);
+        bool first = true;
+        for (size_t event = 0; event < PERF_EVENT_COUNT; ++event) {
+          if (!perfCounters.IsAvailable(static_cast<PerfEvent>(event))) { continue; }
+          std::fprintf(file, "%s\"%s\": %.1f", first ? "" : ", ", PerfCounters::Name(static_cast<PerfEvent>(event)),
+            (*counters)[event]);
+          first = false;
+        }
+        std::fputc('}', file);
+      }
+      std::fputc('}', file);
+    }
+    std::fprintf(file, "\n  ],\n  \"registry\": %s", ToJson(registryStats).c_str());
+    if (AllocTracker::IsCompiledIn()) {
+      std::fprintf(file, ",\n  \"allocations\": {\"warmup_frames\": %llu, \"steady_total\": %llu, \"max_per_frame\": %llu}",
+        static_cast<unsigned long long>(warmupFrames), static_cast<unsigned long long>(steadyAllocations),
+        static_cast<unsigned long long>(maxFrameAllocations));
+    }
+    std::fputs("\n}\n", file);
+    std::fclose(file);
+  }
+  return overAllocationBudget ? 2 : 0;
+}
@@ -0,0 +1,94 @@
+//
+// Created by chaku on 11/12/23.
+//
+
+#include "JobPool.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+
+namespace {
+// set while the thread works on a job, nested jobs then run inline
+thread_local bool t_insideJob = false;
+}// namespace
+
+JobPool::JobPool(size_t threads) {
+  m_threads.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    m_threads.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+JobPool::~JobPool() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  m_threads.clear();
+}
+
+JobPool& JobPool::Shared() {
+  static JobPool pool(WorkerCount() - 1);
+  return pool;
+}
+
+void JobPool::Drain(const Job& job) {
+  const auto wasInside = t_insideJob;
+  t_insideJob = true;
+  for (auto i = m_next.fetch_add(1, std::memory_order_relaxed); i < job.count;
+       i = m_next.fetch_add(1, std::memory_order_relaxed)) {
+    job.invoke(job.context, i);
+  }
+  t_insideJob = wasInside;
+}
+
+void JobPool::WorkerLoop(size_t index) {
+  uint64_t seen = 0;
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock(m_mutex);
+      m_wake.wait(lock, [this, seen] { return m_stopping || m_generation != seen; });
+      if (m_stopping) { return; }
+      seen = m_generation;
+      if (index >= m_job.helpers) { continue; }
+      job = m_job;
+    }
+    Drain(job);
+    bool last = false;
+    {
+      std::lock_guard lock(m_mutex);
+      last = --m_busyHelpers == 0;
+    }
+    if (last) { m_done.notify_one(); }
+  }
+}
+
+void JobPool::Run(size_t count, Invoke invoke, void* context, size_t maxWorkers) {
+  if (count == 0) { return; }
+  const auto workers = std::min({ count, maxWorkers == 0 ? Concurrency() : maxWorkers, Concurrency() });
+  // a job can't wait on pool threads that are busy with the job it was started from
+  if (workers <= 1 || t_insideJob || !m_submitMutex.try_lock()) {
+    const auto wasInside = t_insideJob;
+    t_insideJob = true;
+    for (size_t i = 0; i < count; ++i) { invoke(context, i); }
+    t_insideJob = wasInside;
+    return;
+  }
+
+  const Job job{ invoke, context, count, workers - 1 };
+  {
+    std::lock_guard lock(m_mutex);
+    m_job = job;
+    m_next.store(0, std::memory_order_relaxed);
+    m_busyHelpers = job.helpers;
+    ++m_generation;
+  }
+  m_wake.notify_all();
+  Drain(job);
+  {
+    std::unique_lock lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyHelpers == 0; });
+  }
+  m_submitMutex.unlock();
+}
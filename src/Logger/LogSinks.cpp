@@ -0,0 +1,168 @@
+//
+// Created by chaku on 25/11/23.
+//
+
+#include "LogSinks.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <unistd.h>
+
+void ConsoleSink::Write(std::string_view /*text*/, std::span<const LogLine> lines) {
+    for (const auto& line : lines) {
+        const auto colour = LogLevelColour(line.lvl);
+        std::fwrite(colour.data(), 1, colour.size(), stdout);
+        std::fwrite(line.text.data(), 1, line.text.size(), stdout);
+    }
+}
+
+void ConsoleSink::Flush() {
+    std::fflush(stdout);
+}
+
+RotatingFileSink::RotatingFileSink(std::string path, size_t maxBytes, std::chrono::seconds maxAge,
+                                   unsigned int maxFiles)
+    : m_path(std::move(path)), m_maxBytes(maxBytes), m_maxAge(maxAge), m_maxFiles(maxFiles) {
+    Open();
+}
+
+RotatingFileSink::~RotatingFileSink() {
+    if (m_file != nullptr) {
+        std::fclose(m_file);
+    }
+}
+
+void RotatingFileSink::Open() {
+    m_file = std::fopen(m_path.c_str(), "ab");
+    if (m_file == nullptr) {
+        std::fprintf(stderr, "RotatingFileSink: could not open %s\n", m_path.c_str());
+        return;
+    }
+    m_size = static_cast<size_t>(std::ftell(m_file));
+    m_opened = std::chrono::steady_clock::now();
+}
+
+void RotatingFileSink::Rotate() {
+    if (m_file != nullptr) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    std::error_code error;
+    auto rotated = [this](unsigned int index) { return m_path + "." + std::to_string(index); };
+    if (m_maxFiles == 0) {
+        std::filesystem::remove(m_path, error);
+    } else {
+        std::filesystem::remove(rotated(m_maxFiles), error);
+        for (auto index = m_maxFiles - 1; index > 0; --index) {
+            std::filesystem::rename(rotated(index), rotated(index + 1), error);
+        }
+        std::filesystem::rename(m_path, rotated(1), error);
+    }
+    Open();
+}
+
+void RotatingFileSink::Write(std::string_view /*text*/, std::span<const LogLine> lines) {
+    // lines are contiguous, so everything up to the next rotation goes out in one fwrite
+    size_t first = 0;
+    while (first < lines.size()) {
+        if (m_file != nullptr && m_size > 0
+            && (m_size + lines[first].text.size() > m_maxBytes || std::chrono::steady_clock::now() - m_opened > m_maxAge)) {
+            Rotate();
+        }
+        if (m_file == nullptr) {
+            return;
+        }
+        size_t bytes = lines[first].text.size();
+        size_t last = first + 1;
+        while (last < lines.size() && m_size + bytes + lines[last].text.size() <= m_maxBytes) {
+            bytes += lines[last++].text.size();
+        }
+        m_size += std::fwrite(lines[first].text.data(), 1, bytes, m_file);
+        first = last;
+    }
+}
+
+void RotatingFileSink::Flush() {
+    if (m_file != nullptr) {
+        std::fflush(m_file);
+    }
+}
+
+RingSink::RingSink(size_t capacity) : m_ring(std::max<size_t>(capacity, 1)) {}
+
+void RingSink::Write(std::string_view text, std::span<const LogLine> /*lines*/) {
+    std::lock_guard lock(m_mutex);
+    if (text.size() >= m_ring.size()) {
+        text.remove_prefix(text.size() - m_ring.size());
+        std::copy(text.begin(), text.end(), m_ring.begin());
+        m_head = 0;
+        m_wrapped = true;
+        return;
+    }
+    const auto first = std::min(text.size(), m_ring.size() - m_head);
+    std::copy_n(text.begin(), first, m_ring.begin() + static_cast<std::ptrdiff_t>(m_head));
+    std::copy(text.begin() + static_cast<std::ptrdiff_t>(first), text.end(), m_ring.begin());
+    m_wrapped = m_wrapped || m_head + text.size() >= m_ring.size();
+    m_head = (m_head + text.size()) % m_ring.size();
+}
+
+std::string RingSink::Snapshot() const {
+    std::lock_guard lock(m_mutex);
+    if (!m_wrapped) {
+        return {m_ring.begin(), m_ring.begin() + static_cast<std::ptrdiff_t>(m_head)};
+    }
+    std::string text(m_ring.begin() + static_cast<std::ptrdiff_t>(m_head), m_ring.end());
+    text.append(m_ring.begin(), m_ring.begin() + static_cast<std::ptrdiff_t>(m_head));
+    const auto firstLineEnd = text.find('\n');
+    text.erase(0, firstLineEnd == std::string::npos ? text.size() : firstLineEnd + 1);
+    return text;
+}
+
+MappedFileSink::MappedFileSink(const std::string& path, size_t chunkBytes)
+    : m_chunkBytes(std::max<size_t>(chunkBytes, static_cast<size_t>(sysconf(_SC_PAGESIZE)))) {
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        std::fprintf(stderr, "MappedFileSink: could not open %s\n", path.c_str());
+    }
+}
+
+MappedFileSink::~MappedFileSink() {
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mapped);
+    }
+    if (m_fd >= 0) {
+        (void)ftruncate(m_fd, static_cast<off_t>(m_size));
+        close(m_fd);
+    }
+}
+
+bool MappedFileSink::Grow(size_t needed) {
+    auto mapped = m_mapped;
+    while (mapped < needed) {
+        mapped += m_chunkBytes;
+    }
+    if (ftruncate(m_fd, static_cast<off_t>(mapped)) != 0) {
+        return false;
+    }
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mapped);
+        m_mapping = nullptr;
+        m_mapped = 0;
+    }
+    void* mapping = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    m_mapping = static_cast<char*>(mapping);
+    m_mapped = mapped;
+    return true;
+}
+
+void MappedFileSink::Write(std::string_view text, std::span<const LogLine> /*lines*/) {
+    if (m_fd < 0 || (m_size + text.size() > m_mapped && !Grow(m_size + text.size()))) {
+        return;
+    }
+    std::copy(text.begin(), text.end(), m_mapping + m_size);
+    m_size += text.size();
+}
@@ -1,41 +1,820 @@
-#include <iomanip>
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
 #include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 /*
 available from gcc13 onwards, using strftime until then
 #include <format>
 */
 #include "Logger.hpp"
+#include "LogSinks.hpp"
+
+namespace {
+// longest line a single record can expand to, the rest is cut off
+constexpr size_t MAX_FORMATTED_MESSAGE = 1024;
+
+std::atomic<uint32_t> g_nextSiteId{0};
+std::atomic<const LogSite*> g_sites{nullptr};
+std::atomic<uint32_t> g_messagesPerSecond{LogLimits{}.messagesPerSecond};
+std::atomic<bool> g_collapseDuplicates{LogLimits{}.collapseDuplicates};
+std::atomic<int64_t> g_nextSweep{0};
+constexpr int64_t LIMIT_WINDOW = 1'000'000'000;// nanoseconds
+
+// Bounded multi-producer multi-consumer queue (D. Vyukov). Every slot carries a sequence number telling
+// whether it is free for the producer of ticket n or holds the record for consumer ticket n.
+// Producers only contend on a CAS of the enqueue ticket, nobody ever takes a lock.
+class LogQueue {
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueue{0};
+    alignas(64) std::atomic<size_t> m_dequeue{0};
 
-auto getCurrentTime() -> std::string {
-    auto t = std::time({});
-    std::string timeString(20, '\0');
-    std::strftime(std::data(timeString), std::size(timeString), "%d-%m-%Y %H:%M:%S", std::localtime(&t));
-    return timeString;
+public:
+    // @return slots a queue asked for capacity ends up with
+    static size_t SizeFor(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) { size <<= 1U; }
+        return size;
+    }
+
+    explicit LogQueue(size_t capacity) {
+        const auto size = SizeFor(capacity);
+        m_slots = std::make_unique<Slot[]>(size);
+        m_mask = size - 1;
+        for (size_t i = 0; i < size; ++i) { m_slots[i].sequence.store(i, std::memory_order_relaxed); }
+    }
+
+    bool TryPush(const LogRecord& record) {
+        auto position = m_enqueue.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& slot = m_slots[position & m_mask];
+            const auto sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (diff == 0) {
+                if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.record.CopyFrom(record);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                position = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(LogRecord& record) {
+        auto position = m_dequeue.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& slot = m_slots[position & m_mask];
+            const auto sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (diff == 0) {
+                if (m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    record.CopyFrom(slot.record);
+                    slot.sequence.store(position + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                position = m_dequeue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t Capacity() const { return m_mask + 1; }
+
+    bool Empty() const {
+        return m_dequeue.load(std::memory_order_acquire) == m_enqueue.load(std::memory_order_acquire);
+    }
+};
+
+// Lines formatted since they were last handed to the sinks
+struct TextBatch {
+    std::vector<char> text;
+    size_t used{0};
+    std::vector<LogLine> lines;
+    uint64_t records{0};// queue records in this batch, binary mode included
+
+    explicit TextBatch(size_t bytes) : text(bytes) { lines.reserve(bytes / 64); }
+};
+
+// localtime + strftime is only redone when the second changes
+class TimeFormatter {
+    int64_t m_cachedSecond{-1};
+    std::array<char, 32> m_text{};
+    size_t m_length{0};
+
+public:
+    std::string_view Format(int64_t second) {
+        if (second != m_cachedSecond) {
+            auto t = static_cast<std::time_t>(second);
+            std::tm local{};
+            localtime_r(&t, &local);
+            m_length = std::strftime(m_text.data(), m_text.size(), "%d-%m-%Y %H:%M:%S", &local);
+            m_cachedSecond = second;
+        }
+        return {m_text.data(), m_length};
+    }
+};
+
+std::string_view LevelPrefix(LogLevel lvl) {
+    switch(lvl) {
+        case LogLevel::INFO : return " INFO | ";
+        case LogLevel::WARN : return " WARN | ";
+        case LogLevel::ERR  : return " ERR | ";
+        default: return "";
+    }
 }
 
-std::ostream& operator<<(std::ostream& os, const LogEntry& entry) {
-    switch(entry.lvl) {
-        case LogLevel::INFO : os << "\033[1;32m INFO | "; break;
-        case LogLevel::WARN : os << "\033[1;33m WARN | "; break;
-        case LogLevel::ERR  : os << "\033[1;31m ERR | " ; break;
-        default: break;
+// record timestamps are steady clock nanoseconds, converted to wall clock time only when printed
+int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// wall clock nanoseconds since epoch at steady clock zero
+int64_t WallClockOffset() {
+    static const int64_t offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - Now();
+    return offset;
+}
+
+int64_t WallSecond(int64_t timestamp) {
+    return (timestamp + WallClockOffset()) / 1'000'000'000;
+}
+
+template <typename T>
+T ReadArg(const LogRecord& record, size_t& offset) {
+    T value{};
+    std::memcpy(&value, record.payload.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+// Decodes the argument of record at offset as text, returns false once the payload is exhausted
+bool NextArg(const LogRecord& record, size_t& offset, std::array<char, 32>& scratch, LogArgType& type,
+             std::string_view& text) {
+    if (offset >= record.length) {
+        return false;
+    }
+    auto toChars = [&scratch](auto value, int base = 10) {
+        const auto result = std::to_chars(scratch.data(), scratch.data() + scratch.size(), value, base);
+        return std::string_view(scratch.data(), static_cast<size_t>(result.ptr - scratch.data()));
+    };
+    type = static_cast<LogArgType>(record.payload[offset++]);
+    switch (type) {
+        case LogArgType::Int: text = toChars(ReadArg<int64_t>(record, offset)); break;
+        case LogArgType::UInt: text = toChars(ReadArg<uint64_t>(record, offset)); break;
+        case LogArgType::Double: {
+            const auto length = std::snprintf(scratch.data(), scratch.size(), "%g", ReadArg<double>(record, offset));
+            text = std::string_view(scratch.data(), static_cast<size_t>(std::max(length, 0)));
+            break;
+        }
+        case LogArgType::Bool: text = ReadArg<bool>(record, offset) ? "true" : "false"; break;
+        case LogArgType::Char: text = std::string_view(record.payload.data() + offset++, 1); break;
+        case LogArgType::String: {
+            const auto size = std::min<size_t>(ReadArg<uint16_t>(record, offset), record.length - offset);
+            text = std::string_view(record.payload.data() + offset, size);
+            offset += size;
+            break;
+        }
+        case LogArgType::Pointer: {
+            scratch[0] = '0';
+            scratch[1] = 'x';
+            const auto address = ReadArg<uintptr_t>(record, offset);
+            const auto result = std::to_chars(scratch.data() + 2, scratch.data() + scratch.size(), address, 16);
+            text = std::string_view(scratch.data(), static_cast<size_t>(result.ptr - scratch.data()));
+            break;
+        }
+        default: offset = record.length; return false;
+    }
+    return true;
+}
+
+// Writes the next argument of record at offset as text, returns false once the payload is exhausted
+bool FormatArg(const LogRecord& record, size_t& offset, char* out, size_t capacity, size_t& used) {
+    std::array<char, 32> scratch{};
+    LogArgType type{};
+    std::string_view text;
+    if (!NextArg(record, offset, scratch, type, text)) {
+        return false;
+    }
+    const auto size = std::min(text.size(), capacity - used);
+    std::memcpy(out + used, text.data(), size);
+    used += size;
+    return true;
+}
+
+// Substitutes the record's arguments into its site's format string, returns the number of chars written
+size_t FormatMessage(const LogRecord& record, char* out, size_t capacity) {
+    size_t used = 0;
+    size_t offset = 0;
+    auto put = [&](std::string_view text) {
+        const auto size = std::min(text.size(), capacity - used);
+        std::memcpy(out + used, text.data(), size);
+        used += size;
+    };
+    for (const char* cursor = record.site->format; *cursor != '\0'; ++cursor) {
+        if ((cursor[0] == '{' && cursor[1] == '{') || (cursor[0] == '}' && cursor[1] == '}')) {
+            put(std::string_view(cursor++, 1));
+        } else if (cursor[0] == '{' && cursor[1] == '}') {
+            if (!FormatArg(record, offset, out, capacity, used)) {
+                put("{?}");
+            }
+            ++cursor;
+        } else {
+            put(std::string_view(cursor, 1));
+        }
+    }
+    if (record.truncated) {
+        put("...");
+    }
+    return used;
+}
+
+// appends one formatted line to out, returns the new length
+size_t FormatRecord(const LogRecord& record, TimeFormatter& time, char* out, size_t capacity) {
+    const auto prefix = LevelPrefix(record.site->lvl);
+    const auto stamp = time.Format(WallSecond(record.timestamp));
+    if (prefix.size() + stamp.size() + 3 + 1 > capacity) { return 0; }
+    char* cursor = out;
+    cursor = std::copy(prefix.begin(), prefix.end(), cursor);
+    cursor = std::copy(stamp.begin(), stamp.end(), cursor);
+    cursor = std::copy_n(" | ", 3, cursor);
+    const auto remaining = capacity - static_cast<size_t>(cursor - out) - 1;
+    cursor += FormatMessage(record, cursor, std::min(remaining, MAX_FORMATTED_MESSAGE));
+    *cursor++ = '\n';
+    return static_cast<size_t>(cursor - out);
+}
+
+const LogSite g_infoSite{LogLevel::INFO, "{}", __FILE__, __LINE__};
+const LogSite g_warnSite{LogLevel::WARN, "{}", __FILE__, __LINE__};
+const LogSite g_errorSite{LogLevel::ERR, "{}", __FILE__, __LINE__};
+const LogSite g_droppedSite{LogLevel::WARN, "Logger queue full, dropped {} messages", __FILE__, __LINE__};
+// reports keep the level of the call site they are about
+const LogSite g_repeatedSites[]{
+    {LogLevel::INFO, "repeated {} times: \"{}\" ({}:{})", __FILE__, __LINE__},
+    {LogLevel::WARN, "repeated {} times: \"{}\" ({}:{})", __FILE__, __LINE__},
+    {LogLevel::ERR, "repeated {} times: \"{}\" ({}:{})", __FILE__, __LINE__}};
+const LogSite g_suppressedSites[]{
+    {LogLevel::INFO, "rate limited, suppressed {} messages: \"{}\" ({}:{})", __FILE__, __LINE__},
+    {LogLevel::WARN, "rate limited, suppressed {} messages: \"{}\" ({}:{})", __FILE__, __LINE__},
+    {LogLevel::ERR, "rate limited, suppressed {} messages: \"{}\" ({}:{})", __FILE__, __LINE__}};
+
+uint64_t HashArguments(const LogRecord& record) {
+    uint64_t hash = 14695981039346656037ULL ^ record.length;
+    for (size_t i = 0; i < record.length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(record.payload[i])) * 1099511628211ULL;
+    }
+    return hash | 1U;// 0 means no previous message
+}
+
+const char* BaseName(const char* path) {
+    const char* slash = std::strrchr(path, '/');
+    return slash != nullptr ? slash + 1 : path;
+}
+
+// write(2) until everything is out, async signal safe so crash handlers can use it too
+void WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const auto written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+// Raw record writer for LoggerConfig::binaryFile, see the format description in Logger.hpp.
+// Buffers by itself and writes straight to the descriptor, so the buffer is all a crash handler has to write out.
+class BinaryLogWriter {
+    int m_fd{-1};
+    std::vector<bool> m_sitesWritten;
+    std::array<char, 1U << 16U> m_buffer{};
+    size_t m_used{0};
+
+    void Append(const void* data, size_t size) {
+        if (m_used + size > m_buffer.size()) {
+            Flush();
+        }
+        if (size > m_buffer.size()) {
+            WriteAll(m_fd, static_cast<const char*>(data), size);
+            return;
+        }
+        std::memcpy(m_buffer.data() + m_used, data, size);
+        m_used += size;
+    }
+
+    template <typename T>
+    void Append(const T& value) {
+        Append(&value, sizeof(T));
+    }
+
+    void AppendText(const char* text) {
+        const auto length = static_cast<uint16_t>(std::min<size_t>(std::strlen(text), UINT16_MAX));
+        Append(length);
+        Append(text, length);
+    }
+
+public:
+    bool Open(const std::string& path) {
+        m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fd < 0) {
+            return false;
+        }
+        m_sitesWritten.clear();
+        m_used = 0;
+        Append(LOG_FILE_MAGIC.data(), LOG_FILE_MAGIC.size());
+        Append(LOG_FILE_VERSION);
+        Append(WallClockOffset());
+        return true;
+    }
+
+    void Close() {
+        if (m_fd >= 0) {
+            Flush();
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    bool IsOpen() const { return m_fd >= 0; }
+
+    // @brief Records encoded but not written yet, what a crash handler writes out
+    void FlushForCrash() const { WriteAll(m_fd, m_buffer.data(), m_used); }
+
+    void Write(const LogRecord& record) {
+        const auto& site = *record.site;
+        if (site.id >= m_sitesWritten.size()) {
+            m_sitesWritten.resize(site.id + 1, false);
+        }
+        if (!m_sitesWritten[site.id]) {
+            m_sitesWritten[site.id] = true;
+            Append(static_cast<uint8_t>(LogFileTag::Site));
+            Append(site.id);
+            Append(static_cast<uint8_t>(site.lvl));
+            Append(static_cast<int32_t>(site.line));
+            AppendText(site.file);
+            AppendText(site.format);
+        }
+        Append(static_cast<uint8_t>(LogFileTag::Record));
+        Append(site.id);
+        Append(record.timestamp);
+        Append(static_cast<uint8_t>(record.truncated));
+        Append(record.length);
+        Append(record.payload.data(), record.length);
+    }
+
+    void Flush() {
+        WriteAll(m_fd, m_buffer.data(), m_used);
+        m_used = 0;
+    }
+};
+
+struct AsyncState {
+    LoggerConfig config;
+    LogQueue queue;
+    std::atomic<LogOverflowPolicy> overflow;// read by producers, which may still hold a retired state being reused
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> reported{0};
+    std::atomic<uint64_t> pushed{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<bool> flushRequested{false};
+    // Crash handlers set crashed and only write batch (or the binary buffer) out while writerBusy is clear,
+    // the writer thread stops touching either once it sees crashed.
+    std::atomic<bool> crashed{false};
+    std::atomic<bool> writerBusy{false};
+    BinaryLogWriter binary;// only used when config.binaryFile is set
+    TextBatch batch{1U << 18U};
+    std::thread writer;
+    AsyncState* nextRetired{nullptr};
+
+    explicit AsyncState(const LoggerConfig& cfg) : queue(cfg.capacity) { Reset(cfg); }
+
+    // Called before the writer thread starts, on a fresh state or a retired one being reused
+    void Reset(const LoggerConfig& cfg) {
+        config = cfg;
+        if (config.sinks.empty()) {
+            config.sinks.push_back(std::make_shared<ConsoleSink>());
+        }
+        overflow.store(cfg.overflow, std::memory_order_relaxed);
+        running.store(true, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+        reported.store(0, std::memory_order_relaxed);
+        pushed.store(0, std::memory_order_relaxed);
+        written.store(0, std::memory_order_relaxed);
+        flushRequested.store(false, std::memory_order_relaxed);
+        crashed.store(false, std::memory_order_relaxed);
+        batch.used = 0;
+        batch.lines.clear();
+        batch.records = 0;
+    }
+};
+
+// Producers load the pointer, the writer thread and crash handlers only touch the queue.
+std::atomic<AsyncState*> g_async{nullptr};
+// States stopped by Logger::Stop. Producers that loaded one just before the stop may still push to it, so they
+// are never freed, the next StartAsync with the same queue size reuses one instead. A plain pointer keeps them
+// reachable until the very end of the process (leak checkers included). Guarded by g_lifecycleMutex.
+AsyncState* g_retired{nullptr};
+std::mutex g_lifecycleMutex;
+std::mutex g_syncMutex;
+TimeFormatter g_syncTime;
+std::terminate_handler g_previousTerminate{nullptr};
+
+// Passes batch to the sinks (or flushes the binary log) and counts its records as written
+void HandOut(AsyncState& state, TextBatch& batch) {
+    if (state.binary.IsOpen()) {
+        state.binary.Flush();
+    } else if (!batch.lines.empty()) {
+        const std::string_view text(batch.text.data(), batch.used);
+        for (const auto& sink : state.config.sinks) {
+            sink->Write(text, batch.lines);
+        }
+        for (const auto& sink : state.config.sinks) {
+            sink->Flush();
+        }
+    }
+    state.written.fetch_add(batch.records, std::memory_order_release);
+    batch.used = 0;
+    batch.lines.clear();
+    batch.records = 0;
+}
+
+// Empties the queue into batch, or the binary log file. Used by the writer thread and, as a last resort,
+// by crash handlers.
+void Drain(AsyncState& state, TimeFormatter& time, TextBatch& batch) {
+    auto write = [&](const LogRecord& record) {
+        if (state.binary.IsOpen()) {
+            state.binary.Write(record);
+            return;
+        }
+        if (batch.used + MAX_FORMATTED_MESSAGE + 64 > batch.text.size()) {
+            HandOut(state, batch);
+        }
+        const auto length = FormatRecord(record, time, batch.text.data() + batch.used, batch.text.size() - batch.used);
+        batch.lines.push_back({record.site->lvl, std::string_view(batch.text.data() + batch.used, length)});
+        batch.used += length;
+    };
+
+    LogRecord record{};
+    while (state.queue.TryPop(record)) {
+        write(record);
+        ++batch.records;
+    }
+
+    const auto dropped = state.dropped.load(std::memory_order_relaxed);
+    const auto reported = state.reported.exchange(dropped, std::memory_order_relaxed);
+    if (state.config.overflow == LogOverflowPolicy::Count && dropped > reported) {
+        LogRecord notice;
+        notice.timestamp = Now();
+        notice.site = &g_droppedSite;
+        notice.AppendArg(dropped - reported);
+        write(notice);
+    }
+}
+
+// Claims batch and the binary log for the writer thread, false once a crash handler owns them.
+// Sequentially consistent so that either the writer sees crashed or the crash handler sees writerBusy.
+bool EnterWriter(AsyncState& state) {
+    state.writerBusy.store(true);
+    if (state.crashed.load()) {
+        state.writerBusy.store(false);
+        return false;
     }
-    os << getCurrentTime() << " | " << entry.message << "\n";
+    return true;
+}
+
+void LeaveWriter(AsyncState& state) {
+    state.writerBusy.store(false);
+}
+
+void WriterLoop(AsyncState& state) {
+    TimeFormatter time;
+    auto lastHandOut = std::chrono::steady_clock::now();
+    while (state.running.load(std::memory_order_acquire)) {
+        if (!EnterWriter(state)) {
+            return;
+        }
+        Drain(state, time, state.batch);
+        const auto now = std::chrono::steady_clock::now();
+        const auto due = now - lastHandOut >= state.config.flushInterval;
+        if ((due || state.flushRequested.exchange(false, std::memory_order_acq_rel))
+            && (state.batch.records > 0 || !state.batch.lines.empty())) {
+            HandOut(state, state.batch);
+            lastHandOut = now;
+        }
+        LeaveWriter(state);
+        if (state.queue.Empty()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+    if (!EnterWriter(state)) {
+        return;
+    }
+    Drain(state, time, state.batch);
+    HandOut(state, state.batch);
+    LeaveWriter(state);
+}
+
+// Runs in signal handlers, so it only write(2)s bytes the writer thread already encoded: the lines batched
+// since the last hand out go to stderr, or the binary log's buffer to its file. Records still in the queue
+// are lost, formatting them is not async signal safe. Nothing is written if the writer doesn't let go of the
+// batch within a short spin (e.g. it is the thread that crashed, inside a sink).
+void FlushOnCrash() {
+    auto* state = g_async.load(std::memory_order_acquire);
+    if (state == nullptr || state->crashed.exchange(true)) {
+        return;
+    }
+    for (int spin = 0; spin < 100'000; ++spin) {
+        if (!state->writerBusy.load()) {
+            if (state->binary.IsOpen()) {
+                state->binary.FlushForCrash();
+            } else {
+                WriteAll(STDERR_FILENO, state->batch.text.data(), state->batch.used);
+            }
+            return;
+        }
+    }
+}
+
+void CrashSignalHandler(int signal) {
+    FlushOnCrash();
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+void InstallCrashHandlers() {
+    for (const auto signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL}) {
+        std::signal(signal, CrashSignalHandler);
+    }
+    const auto previous = std::set_terminate([]() {
+        FlushOnCrash();
+        if (g_previousTerminate != nullptr) { g_previousTerminate(); }
+        std::abort();
+    });
+    if (g_previousTerminate == nullptr) { g_previousTerminate = previous; }
+}
+
+}
+
+LogSite::LogSite(LogLevel level, const char* formatString, const char* fileName, int lineNumber)
+    : LogSite(level, formatString, fileName, lineNumber, g_nextSiteId.fetch_add(1, std::memory_order_relaxed)) {
+    next = g_sites.load(std::memory_order_relaxed);
+    while (!g_sites.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+LogSite::LogSite(LogLevel level, const char* formatString, const char* fileName, int lineNumber, uint32_t siteId)
+    : lvl(level), format(formatString), file(fileName), line(lineNumber), id(siteId) {}
+
+std::string FormatLogMessage(const LogRecord& record) {
+    std::string text(MAX_FORMATTED_MESSAGE, '\0');
+    text.resize(FormatMessage(record, text.data(), text.size()));
+    return text;
+}
+
+void ForEachLogArg(const LogRecord& record, const std::function<void(LogArgType, std::string_view)>& visit) {
+    std::array<char, 32> scratch{};
+    LogArgType type{};
+    std::string_view text;
+    size_t offset = 0;
+    while (NextArg(record, offset, scratch, type, text)) {
+        visit(type, text);
+    }
+}
+
+namespace {
+// Hands a record to the writer thread, or writes it right away in sync mode
+void Enqueue(const LogRecord& record) {
+    auto* state = g_async.load(std::memory_order_acquire);
+    if (state == nullptr) {
+        std::array<char, MAX_FORMATTED_MESSAGE + 64> line{};
+        std::lock_guard lock(g_syncMutex);
+        const auto length = FormatRecord(record, g_syncTime, line.data(), line.size());
+        std::cout << LogLevelColour(record.site->lvl);
+        std::cout.write(line.data(), static_cast<std::streamsize>(length));
+        return;
+    }
+
+    while (!state->queue.TryPush(record)) {
+        // a stopped writer won't make room any more
+        if (state->overflow.load(std::memory_order_relaxed) != LogOverflowPolicy::Block
+            || !state->running.load(std::memory_order_relaxed)) {
+            state->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::this_thread::yield();
+    }
+    state->pushed.fetch_add(1, std::memory_order_release);
+}
+
+void ReportCount(const LogSite* reports, std::atomic<uint64_t>& counter, const LogSite& site, int64_t now) {
+    if (counter.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    const auto count = counter.exchange(0, std::memory_order_relaxed);
+    if (count == 0) {
+        return;
+    }
+    LogRecord report;
+    report.timestamp = now;
+    report.site = &reports[site.lvl];
+    report.AppendArg(count);
+    report.AppendArg(site.format);
+    report.AppendArg(BaseName(site.file));
+    report.AppendArg(site.line);
+    Enqueue(report);
+}
+
+// Reports counts collected for site, the caller makes sure they belong before whatever is logged next
+void ReportPending(const LogSite& site, int64_t now) {
+    ReportCount(g_repeatedSites, site.repeated, site, now);
+    ReportCount(g_suppressedSites, site.suppressed, site, now);
+}
+
+// A site that keeps repeating itself or stops logging altogether would hold on to its counts,
+// so they are reported for every site at most once per window.
+void SweepSites(int64_t now, bool force) {
+    auto next = g_nextSweep.load(std::memory_order_relaxed);
+    if (!force && (now < next || !g_nextSweep.compare_exchange_strong(next, now + LIMIT_WINDOW,
+                                     std::memory_order_relaxed))) {
+        return;
+    }
+    for (const auto* site = g_sites.load(std::memory_order_acquire); site != nullptr; site = site->next) {
+        ReportPending(*site, now);
+    }
+}
+}
+
+void Logger::Submit(LogRecord& record, bool limited) {
+    const auto now = Now();
+    const auto& site = *record.site;
+    record.timestamp = now;
+    if (!limited) {
+        Enqueue(record);
+        return;
+    }
+
+    if (g_collapseDuplicates.load(std::memory_order_relaxed)) {
+        const auto hash = HashArguments(record);
+        if (site.lastHash.exchange(hash, std::memory_order_relaxed) == hash) {
+            site.repeated.fetch_add(1, std::memory_order_relaxed);
+            SweepSites(now, false);
+            return;
+        }
+    }
+    // a different message ends the run of duplicates, say so before it
+    ReportCount(g_repeatedSites, site.repeated, site, now);
+
+    const auto limit = g_messagesPerSecond.load(std::memory_order_relaxed);
+    if (limit != 0) {
+        auto windowStart = site.windowStart.load(std::memory_order_relaxed);
+        if (now - windowStart >= LIMIT_WINDOW
+            && site.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+            site.windowCount.store(0, std::memory_order_relaxed);
+            ReportCount(g_suppressedSites, site.suppressed, site, now);
+        }
+        if (site.windowCount.fetch_add(1, std::memory_order_relaxed) >= limit) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            SweepSites(now, false);
+            return;
+        }
+    }
+
+    Enqueue(record);
+    SweepSites(now, false);
+}
+
+void Logger::SetLimits(const LogLimits& limits) {
+    g_messagesPerSecond.store(limits.messagesPerSecond, std::memory_order_relaxed);
+    g_collapseDuplicates.store(limits.collapseDuplicates, std::memory_order_relaxed);
+}
+
+std::string_view LogLevelColour(LogLevel lvl) {
+    switch(lvl) {
+        case LogLevel::INFO : return "\033[1;32m";
+        case LogLevel::WARN : return "\033[1;33m";
+        case LogLevel::ERR  : return "\033[1;31m";
+        default: return "";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const LogEntry& entry) {
+    std::lock_guard lock(g_syncMutex);
+    os << LogLevelColour(entry.lvl) << LevelPrefix(entry.lvl) << g_syncTime.Format(WallSecond(Now())) << " | " << entry.message << "\n";
     return os;
 }
 
 void Logger::Info(const std::string_view& msg) {
-    LogEntry logEntry{LogLevel::INFO, msg};
-    std::cout << logEntry;
+    if constexpr (LogLevel::INFO >= STABBY2D_LOG_MIN_LEVEL) {
+        Write(g_infoSite, msg);
+    }
 }
 
 void Logger::Warn(const std::string_view& msg) {
-    LogEntry logEntry{LogLevel::WARN, msg};
-    std::cout << logEntry;
+    if constexpr (LogLevel::WARN >= STABBY2D_LOG_MIN_LEVEL) {
+        Write(g_warnSite, msg);
+    }
 }
 
 void Logger::Error(const std::string_view& msg) {
-    LogEntry logEntry{LogLevel::ERR, msg};
-    std::cout << logEntry;
-}
\ No newline at end of file
+    if constexpr (LogLevel::ERR >= STABBY2D_LOG_MIN_LEVEL) {
+        Write(g_errorSite, msg);
+    }
+}
+
+void Logger::StartAsync(const LoggerConfig& config) {
+    std::lock_guard lock(g_lifecycleMutex);
+    if (g_async.load() != nullptr) {
+        return;
+    }
+    std::cout.flush();
+    AsyncState* state = nullptr;
+    for (auto** link = &g_retired; *link != nullptr; link = &(*link)->nextRetired) {
+        if ((*link)->queue.Capacity() == LogQueue::SizeFor(config.capacity)) {
+            state = *link;
+            *link = state->nextRetired;
+            state->nextRetired = nullptr;
+            state->Reset(config);
+            break;
+        }
+    }
+    if (state == nullptr) {
+        state = new AsyncState(config);
+    }
+    if (!config.binaryFile.empty() && !state->binary.Open(config.binaryFile)) {
+        LOG_ERROR("Could not open binary log {}, logging text to stdout", config.binaryFile);
+    }
+    state->writer = std::thread(WriterLoop, std::ref(*state));
+    g_async.store(state, std::memory_order_release);
+    if (config.flushOnCrash) {
+        InstallCrashHandlers();
+    }
+    static const bool stopAtExit = (std::atexit([]() { Logger::Stop(); }), true);
+    (void)stopAtExit;
+}
+
+void Logger::Stop() {
+    SweepSites(Now(), true);
+    std::lock_guard lock(g_lifecycleMutex);
+    auto* state = g_async.exchange(nullptr, std::memory_order_acq_rel);
+    if (state == nullptr) {
+        return;
+    }
+    state->running.store(false, std::memory_order_release);
+    state->writer.join();
+    state->binary.Close();
+    // sinks may own files that should be closed now rather than never
+    state->config.sinks.clear();
+    // producers that loaded the pointer before the exchange may still be pushing, so the state is kept for
+    // reuse rather than freed under them
+    state->nextRetired = g_retired;
+    g_retired = state;
+}
+
+void Logger::Flush() {
+    SweepSites(Now(), true);
+    auto* state = g_async.load(std::memory_order_acquire);
+    if (state == nullptr) {
+        std::cout.flush();
+        return;
+    }
+    const auto target = state->pushed.load(std::memory_order_acquire);
+    while (state->written.load(std::memory_order_acquire) < target && state->running.load()) {
+        state->flushRequested.store(true, std::memory_order_release);
+        std::this_thread::yield();
+    }
+}
+
+uint64_t Logger::DroppedCount() {
+    auto* state = g_async.load(std::memory_order_acquire);
+    return state == nullptr ? 0 : state->dropped.load(std::memory_order_relaxed);
+}
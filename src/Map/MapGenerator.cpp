@@ -0,0 +1,151 @@
+//
+// Created by chaku on 02/11/23.
+//
+
+#include "MapGenerator.hpp"
+#include "ParallelFor.hpp"
+#include <cmath>
+
+namespace {
+// splitmix64 finaliser, used both as a hash and as a tiny RNG. Unlike <random> distributions
+// its output is identical on every standard library, which keeps seeds portable.
+auto Mix(uint64_t x) -> uint64_t {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27U)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31U);
+}
+
+auto HashCoords(uint64_t seed, int64_t x, int64_t y) -> uint64_t {
+  return Mix(seed ^ Mix(static_cast<uint64_t>(x) ^ Mix(static_cast<uint64_t>(y))));
+}
+
+// @return value in [0, 1)
+auto ToUnit(uint64_t bits) -> float { return static_cast<float>(bits >> 40U) / static_cast<float>(1U << 24U); }
+
+auto Smooth(float t) -> float { return t * t * (3.0F - 2.0F * t); }
+
+auto ValueNoise(uint64_t seed, float x, float y) -> float {
+  const auto x0 = static_cast<int64_t>(std::floor(x));
+  const auto y0 = static_cast<int64_t>(std::floor(y));
+  const auto tx = Smooth(x - static_cast<float>(x0));
+  const auto ty = Smooth(y - static_cast<float>(y0));
+
+  const auto v00 = ToUnit(HashCoords(seed, x0, y0));
+  const auto v10 = ToUnit(HashCoords(seed, x0 + 1, y0));
+  const auto v01 = ToUnit(HashCoords(seed, x0, y0 + 1));
+  const auto v11 = ToUnit(HashCoords(seed, x0 + 1, y0 + 1));
+
+  const auto top = v00 + (v10 - v00) * tx;
+  const auto bottom = v01 + (v11 - v01) * tx;
+  return top + (bottom - top) * ty;
+}
+
+// fractal sum of value noise octaves, normalised to [0, 1)
+auto Height(const MapGeneratorSettings& settings, int64_t x, int64_t y) -> float {
+  float sum = 0.0F;
+  float amplitude = 1.0F;
+  float total = 0.0F;
+  float frequency = settings.noiseScale;
+  for (uint8_t octave = 0; octave < settings.octaves; ++octave) {
+    sum += amplitude * ValueNoise(settings.seed + octave, static_cast<float>(x) * frequency,
+                         static_cast<float>(y) * frequency);
+    total += amplitude;
+    amplitude *= 0.5F;
+    frequency *= 2.0F;
+  }
+  return total > 0.0F ? sum / total : 0.0F;
+}
+
+enum class Terrain : uint8_t { Water, Sand, Grass, Forest };
+}// namespace
+
+auto MapGenerator::ChunkSeed(int32_t chunkX, int32_t chunkY) const -> uint64_t {
+  return HashCoords(Mix(m_settings.seed), chunkX, chunkY);
+}
+
+auto MapGenerator::GenerateChunk(int32_t chunkX, int32_t chunkY) const -> TileMap {
+  const auto size = static_cast<int64_t>(m_settings.chunkSize);
+  const auto halo = static_cast<int64_t>(m_settings.smoothingPasses);
+  const auto span = size + 2 * halo;
+  const auto originX = static_cast<int64_t>(chunkX) * size - halo;
+  const auto originY = static_cast<int64_t>(chunkY) * size - halo;
+  const auto forestSeed = Mix(m_settings.seed ^ 0xF0F0F0F0ULL);
+
+  // classify the chunk plus its halo, initial forest noise is hashed per world tile so halos agree
+  std::vector<Terrain> cells(static_cast<size_t>(span * span));
+  for (int64_t y = 0; y < span; ++y) {
+    for (int64_t x = 0; x < span; ++x) {
+      const auto worldX = originX + x;
+      const auto worldY = originY + y;
+      const auto height = Height(m_settings, worldX, worldY);
+      auto& cell = cells[static_cast<size_t>(y * span + x)];
+      if (height < m_settings.waterLevel) {
+        cell = Terrain::Water;
+      } else if (height < m_settings.sandLevel) {
+        cell = Terrain::Sand;
+      } else {
+        const auto roll = ToUnit(HashCoords(forestSeed, worldX, worldY));
+        cell = roll < m_settings.forestDensity ? Terrain::Forest : Terrain::Grass;
+      }
+    }
+  }
+
+  // each pass shrinks the valid region by one tile, so after `halo` passes exactly the chunk is valid
+  std::vector<Terrain> next(cells.size());
+  for (int64_t pass = 0; pass < halo; ++pass) {
+    const auto lo = pass + 1;
+    const auto hi = span - pass - 1;
+    next = cells;
+    for (int64_t y = lo; y < hi; ++y) {
+      for (int64_t x = lo; x < hi; ++x) {
+        const auto index = static_cast<size_t>(y * span + x);
+        if (cells[index] != Terrain::Grass && cells[index] != Terrain::Forest) { continue; }
+        int forestNeighbours = 0;
+        for (int64_t dy = -1; dy <= 1; ++dy) {
+          for (int64_t dx = -1; dx <= 1; ++dx) {
+            forestNeighbours += cells[static_cast<size_t>((y + dy) * span + x + dx)] == Terrain::Forest ? 1 : 0;
+          }
+        }
+        next[index] = forestNeighbours >= 5 ? Terrain::Forest : Terrain::Grass;
+      }
+    }
+    std::swap(cells, next);
+  }
+
+  // decorations only touch tiles owned by this chunk, so they can use the chunk's own seed
+  auto rng = ChunkSeed(chunkX, chunkY);
+  const auto& palette = m_settings.palette;
+  TileMap chunk(m_settings.chunkSize, m_settings.chunkSize);
+  for (int64_t y = 0; y < size; ++y) {
+    for (int64_t x = 0; x < size; ++x) {
+      const auto cell = cells[static_cast<size_t>((y + halo) * span + x + halo)];
+      rng = Mix(rng);
+      int tile = palette.grass;
+      switch (cell) {
+        case Terrain::Water: tile = palette.water; break;
+        case Terrain::Sand: tile = palette.sand; break;
+        case Terrain::Forest: tile = palette.forest; break;
+        case Terrain::Grass: tile = ToUnit(rng) < m_settings.bushChance ? palette.bush : palette.grass; break;
+      }
+      chunk.At(static_cast<uint32_t>(x), static_cast<uint32_t>(y)) = tile;
+    }
+  }
+  return chunk;
+}
+
+auto MapGenerator::Generate(uint32_t chunksX, uint32_t chunksY) const -> TileMap {
+  const auto size = m_settings.chunkSize;
+  TileMap map(chunksX * size, chunksY * size);
+
+  // chunks write disjoint rectangles of the output, so no synchronisation is needed beyond the join
+  ParallelFor(static_cast<size_t>(chunksX) * chunksY, [&](size_t index) {
+    const auto chunkX = static_cast<uint32_t>(index % chunksX);
+    const auto chunkY = static_cast<uint32_t>(index / chunksX);
+    const auto chunk = GenerateChunk(static_cast<int32_t>(chunkX), static_cast<int32_t>(chunkY));
+    for (uint32_t y = 0; y < size; ++y) {
+      for (uint32_t x = 0; x < size; ++x) { map.At(chunkX * size + x, chunkY * size + y) = chunk.At(x, y); }
+    }
+  });
+  return map;
+}
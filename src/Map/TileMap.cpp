@@ -0,0 +1,35 @@
+//
+// Created by chaku on 02/11/23.
+//
+
+#include "TileMap.hpp"
+#include "Logger.hpp"
+#include <fstream>
+#include <sstream>
+
+auto LoadTileMap(const std::string& fileName) -> std::optional<TileMap> {
+  const char delim{','};
+  std::ifstream mapFile(fileName);
+  if (mapFile.fail()) {
+    LOG_ERROR("Could not open {}", fileName);
+    return std::nullopt;
+  }
+
+  // the first row decides the width, shorter rows are padded with tile 0 and longer ones are cut
+  TileMap map;
+  for (std::string line; std::getline(mapFile, line);) {
+    std::vector<int> row;
+    std::string numStr;
+    std::stringstream ssLine(line);
+    while (std::getline(ssLine, numStr, delim)) { row.push_back(std::stoi(numStr)); }
+    if (row.empty()) { continue; }
+    if (map.height == 0) { map.width = static_cast<uint32_t>(row.size()); }
+    if (row.size() != map.width) {
+      LOG_WARN("Row {} of {} does not match the map width", map.height, fileName);
+      row.resize(map.width, 0);
+    }
+    map.tiles.insert(map.tiles.end(), row.begin(), row.end());
+    ++map.height;
+  }
+  return map;
+}
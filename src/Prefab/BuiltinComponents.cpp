@@ -0,0 +1,71 @@
+//
+// Created by chaku on 11/11/23.
+//
+
+#include "BehaviourComponent.hpp"
+#include "PerceptionComponent.hpp"
+#include "PrefabLoader.hpp"
+#include "RigidBodyComponent.hpp"
+#include "SpriteComponent.hpp"
+#include "Tags.hpp"
+#include "TransformComponent.hpp"
+
+namespace {
+template <typename TTag>
+void RegisterTag(PrefabLoader& loader, const std::string& name) {
+  loader.Register(name, [](std::istringstream&, Prefab& prefab) {
+    prefab.Set<TTag>();
+    return true;
+  });
+}
+}// namespace
+
+void RegisterBuiltinComponents(PrefabLoader& loader) {
+  RegisterTag<PlayerTag>(loader, "PlayerTag");
+  RegisterTag<EnemyTag>(loader, "EnemyTag");
+  RegisterTag<StaticTag>(loader, "StaticTag");
+  RegisterTag<VisibleTag>(loader, "VisibleTag");
+
+  // TransformComponent <x> <y> <scaleX> <scaleY> <rotation>
+  loader.Register("TransformComponent", [](std::istringstream& args, Prefab& prefab) {
+    float x{}, y{}, scaleX{}, scaleY{};
+    Rotation rotation{};
+    if (!(args >> x >> y >> scaleX >> scaleY >> rotation)) { return false; }
+    prefab.Set<TransformComponent>(Position(x, y), Scale(scaleX, scaleY), rotation);
+    return true;
+  });
+
+  // RigidBodyComponent <velocityX> <velocityY>
+  loader.Register("RigidBodyComponent", [](std::istringstream& args, Prefab& prefab) {
+    float x{}, y{};
+    if (!(args >> x >> y)) { return false; }
+    prefab.Set<RigidBodyComponent>(Velocity(x, y));
+    return true;
+  });
+
+  // SpriteComponent <textureName> <width> <height> <srcX> <srcY> <srcW> <srcH>
+  loader.Register("SpriteComponent", [](std::istringstream& args, Prefab& prefab) {
+    std::string name;
+    int width{}, height{};
+    SDL_Rect srcRect{};
+    if (!(args >> name >> width >> height >> srcRect.x >> srcRect.y >> srcRect.w >> srcRect.h)) { return false; }
+    prefab.Set<SpriteComponent>(name, width, height, srcRect);
+    return true;
+  });
+
+  // PerceptionComponent <visionRange>
+  loader.Register("PerceptionComponent", [](std::istringstream& args, Prefab& prefab) {
+    float visionRange{};
+    if (!(args >> visionRange)) { return false; }
+    prefab.Set<PerceptionComponent>(visionRange);
+    return true;
+  });
+
+  // BehaviourComponent <treeId>
+  loader.Register("BehaviourComponent", [](std::istringstream& args, Prefab& prefab) {
+    uint16_t treeId{};
+    if (!(args >> treeId)) { return false; }
+    prefab.Set<BehaviourComponent>(treeId);
+    return true;
+  });
+}
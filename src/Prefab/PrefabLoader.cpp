@@ -0,0 +1,40 @@
+//
+// Created by chaku on 11/11/23.
+//
+
+#include "PrefabLoader.hpp"
+#include "Logger.hpp"
+#include <fstream>
+
+void PrefabLoader::Register(const std::string& componentName, Parser parser) {
+  m_parsers[componentName] = std::move(parser);
+}
+
+std::optional<Prefab> PrefabLoader::Load(const std::string& filePath) const {
+  std::ifstream prefabFile(filePath);
+  if (prefabFile.fail()) {
+    LOG_ERROR("Could not open {}", filePath);
+    return std::nullopt;
+  }
+
+  Prefab prefab;
+  size_t lineNumber = 0;
+  for (std::string line; std::getline(prefabFile, line);) {
+    ++lineNumber;
+    std::istringstream args(line);
+    std::string componentName;
+    if (!(args >> componentName) || componentName.front() == '#') { continue; }
+
+    const auto parser = m_parsers.find(componentName);
+    if (parser == m_parsers.end()) {
+      LOG_ERROR("{}:{} unknown component {}", filePath, lineNumber, componentName);
+      return std::nullopt;
+    }
+    if (!parser->second(args, prefab)) {
+      LOG_ERROR("{}:{} malformed {}", filePath, lineNumber, componentName);
+      return std::nullopt;
+    }
+  }
+  LOG_INFO("Loaded prefab from {}", filePath);
+  return prefab;
+}
@@ -0,0 +1,263 @@
+//
+// Created by chaku on 03/12/23.
+//
+
+#include "AllocTracker.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <iterator>
+#include <mutex>
+#include <new>
+
+namespace {
+// Per thread counters live in a fixed table so counting never allocates. A thread leases a slot on its first
+// allocation and returns it on exit; counters are never reset so the next owner keeps adding to them and
+// Total() stays correct.
+struct alignas(64) Slot {
+    std::atomic<bool> inUse{false};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+constexpr size_t SLOT_COUNT = 256;
+std::array<Slot, SLOT_COUNT> g_slots;
+// shared by threads that found the table full or are past their lease's destruction
+Slot g_overflow;
+
+thread_local Slot* t_slot = nullptr;
+thread_local bool t_exited = false;
+
+Slot* AcquireSlot() {
+    for (auto& slot : g_slots) {
+        bool expected = false;
+        if (!slot.inUse.load(std::memory_order_relaxed) &&
+            slot.inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return &slot;
+        }
+    }
+    return &g_overflow;
+}
+
+struct SlotLease {
+    SlotLease() { t_slot = AcquireSlot(); }
+    SlotLease(const SlotLease&) = delete;
+    SlotLease& operator=(const SlotLease&) = delete;
+    ~SlotLease() {
+        if (t_slot != &g_overflow) { t_slot->inUse.store(false, std::memory_order_release); }
+        t_slot = nullptr;
+        t_exited = true;
+    }
+};
+
+Slot& LocalSlot() {
+    if (t_slot != nullptr) { return *t_slot; }
+    if (t_exited) { return g_overflow; }
+    thread_local SlotLease lease;
+    return *t_slot;
+}
+
+constexpr size_t SAMPLE_DEPTH = 8;
+// backtrace() frames belonging to the tracker itself: SampleCallStack and the operator new that called it,
+// everything in between is forced inline
+constexpr int SKIPPED_FRAMES = 2;
+constexpr size_t SAMPLE_TABLE_SIZE = 1024;
+
+struct SampleEntry {
+    std::array<void*, SAMPLE_DEPTH> frames{};
+    int depth{0};
+    uint64_t allocations{0};
+    uint64_t bytes{0};
+};
+
+std::atomic<uint32_t> g_sampleInterval{0};
+std::mutex g_samplesMutex;
+std::array<SampleEntry, SAMPLE_TABLE_SIZE> g_samples;
+thread_local uint32_t t_untilSample = 0;
+thread_local bool t_sampling = false;
+
+[[gnu::noinline]] void SampleCallStack(size_t size) {
+    // backtrace() can allocate the first time it runs, don't sample that
+    t_sampling = true;
+    std::array<void*, SAMPLE_DEPTH + SKIPPED_FRAMES> frames{};
+    const auto captured = backtrace(frames.data(), static_cast<int>(frames.size()));
+    const auto depth = std::max(0, captured - SKIPPED_FRAMES);
+
+    size_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < depth; ++i) { hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i + SKIPPED_FRAMES])) * 1099511628211ULL; }
+    {
+        std::lock_guard lock(g_samplesMutex);
+        // open addressing, a full table drops new stacks
+        for (size_t probe = 0; probe < SAMPLE_TABLE_SIZE; ++probe) {
+            auto& entry = g_samples[(hash + probe) % SAMPLE_TABLE_SIZE];
+            if (entry.allocations == 0) {
+                std::copy_n(frames.begin() + SKIPPED_FRAMES, depth, entry.frames.begin());
+                entry.depth = depth;
+            } else if (entry.depth != depth ||
+                       !std::equal(entry.frames.begin(), entry.frames.begin() + depth, frames.begin() + SKIPPED_FRAMES)) {
+                continue;
+            }
+            ++entry.allocations;
+            entry.bytes += size;
+            break;
+        }
+    }
+    t_sampling = false;
+}
+
+[[gnu::always_inline]] inline void CountAllocation(size_t size) {
+    auto& slot = LocalSlot();
+    slot.allocations.fetch_add(1, std::memory_order_relaxed);
+    slot.bytes.fetch_add(size, std::memory_order_relaxed);
+
+    const auto interval = g_sampleInterval.load(std::memory_order_relaxed);
+    if (interval == 0 || t_sampling) { return; }
+    if (t_untilSample == 0 || t_untilSample > interval) { t_untilSample = interval; }
+    if (--t_untilSample == 0) { SampleCallStack(size); }
+}
+
+std::string Symbolise(void* address) {
+    Dl_info info{};
+    if (dladdr(address, &info) == 0) {
+        std::array<char, 32> buffer{};
+        std::snprintf(buffer.data(), buffer.size(), "%p", address);
+        return buffer.data();
+    }
+    std::array<char, 32> offset{};
+    if (info.dli_sname != nullptr) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+        std::free(demangled);
+        std::snprintf(offset.data(), offset.size(), "+0x%zx",
+            static_cast<size_t>(static_cast<char*>(address) - static_cast<char*>(info.dli_saddr)));
+        return name + offset.data();
+    }
+    // not exported, module offset is what addr2line wants
+    std::snprintf(offset.data(), offset.size(), "+0x%zx",
+        static_cast<size_t>(static_cast<char*>(address) - static_cast<char*>(info.dli_fbase)));
+    return std::string(info.dli_fname != nullptr ? info.dli_fname : "?") + offset.data();
+}
+}// namespace
+
+AllocCounters AllocTracker::Thread() {
+    const auto& slot = LocalSlot();
+    return { slot.allocations.load(std::memory_order_relaxed), slot.frees.load(std::memory_order_relaxed),
+        slot.bytes.load(std::memory_order_relaxed) };
+}
+
+AllocCounters AllocTracker::Total() {
+    AllocCounters total{};
+    auto add = [&total](const Slot& slot) {
+        total.allocations += slot.allocations.load(std::memory_order_relaxed);
+        total.frees += slot.frees.load(std::memory_order_relaxed);
+        total.bytes += slot.bytes.load(std::memory_order_relaxed);
+    };
+    for (const auto& slot : g_slots) { add(slot); }
+    add(g_overflow);
+    return total;
+}
+
+void AllocTracker::SetSampleInterval(uint32_t interval) {
+    g_sampleInterval.store(interval, std::memory_order_relaxed);
+}
+
+void AllocTracker::ClearSamples() {
+    std::lock_guard lock(g_samplesMutex);
+    g_samples.fill({});
+}
+
+std::vector<AllocSite> AllocTracker::TopSites(size_t count) {
+    std::vector<SampleEntry> entries;
+    // allocating under the lock would deadlock with our own sampling
+    entries.reserve(SAMPLE_TABLE_SIZE);
+    {
+        std::lock_guard lock(g_samplesMutex);
+        std::copy_if(g_samples.begin(), g_samples.end(), std::back_inserter(entries),
+            [](const SampleEntry& entry) { return entry.allocations > 0; });
+    }
+    std::sort(entries.begin(), entries.end(),
+        [](const SampleEntry& a, const SampleEntry& b) { return a.allocations > b.allocations; });
+    entries.resize(std::min(count, entries.size()));
+
+    std::vector<AllocSite> sites;
+    for (const auto& entry : entries) {
+        AllocSite site{ entry.allocations, entry.bytes, {} };
+        for (int i = 0; i < entry.depth; ++i) { site.frames.push_back(Symbolise(entry.frames[i])); }
+        sites.push_back(std::move(site));
+    }
+    return sites;
+}
+
+#ifdef STABBY2D_ALLOC_TRACKING
+// Replacements for the global allocation functions, malloc underneath so the hooks never recurse
+
+namespace {
+[[gnu::always_inline]] inline void* Allocate(size_t size) noexcept {
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer != nullptr) { CountAllocation(size); }
+    return pointer;
+}
+
+[[gnu::always_inline]] inline void* AllocateAligned(size_t size, std::align_val_t alignment) noexcept {
+    const auto align = static_cast<size_t>(alignment);
+    // aligned_alloc wants the size to be a multiple of the alignment
+    void* pointer = std::aligned_alloc(align, ((size == 0 ? 1 : size) + align - 1) / align * align);
+    if (pointer != nullptr) { CountAllocation(size); }
+    return pointer;
+}
+
+void CountFree(void* pointer) {
+    if (pointer != nullptr) { LocalSlot().frees.fetch_add(1, std::memory_order_relaxed); }
+}
+
+void Free(void* pointer) noexcept {
+    CountFree(pointer);
+    std::free(pointer);
+}
+}// namespace
+
+[[gnu::noinline]] void* operator new(size_t size) {
+    if (void* pointer = Allocate(size)) { return pointer; }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void* operator new[](size_t size) {
+    if (void* pointer = Allocate(size)) { return pointer; }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+[[gnu::noinline]] void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+[[gnu::noinline]] void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* pointer = AllocateAligned(size, alignment)) { return pointer; }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void* operator new[](size_t size, std::align_val_t alignment) {
+    if (void* pointer = AllocateAligned(size, alignment)) { return pointer; }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return AllocateAligned(size, alignment);
+}
+[[gnu::noinline]] void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept { Free(pointer); }
+void operator delete[](void* pointer) noexcept { Free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Free(pointer); }
+#endif
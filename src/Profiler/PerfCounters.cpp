@@ -0,0 +1,108 @@
+//
+// Created by chaku on 05/12/23.
+//
+
+#include "PerfCounters.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr std::array<const char*, PERF_EVENT_COUNT> eventNames{
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+};
+
+#ifdef __linux__
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr std::array<EventConfig, PERF_EVENT_COUNT> eventConfigs{{
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8U) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+}};
+
+// @param groupLeader fd of the first counter opened, -1 to open the leader itself
+int OpenEvent(const EventConfig& event, int groupLeader) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The JobPool threads live as long as the process, inherit would only fold their counts in at exit, so
+    // only the calling thread is counted. One group: the kernel schedules (and multiplexes) the counters
+    // together and a single read of the leader returns all of them for the same stretch of execution.
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupLeader, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+}// namespace
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const auto fd : m_fds) {
+        if (fd >= 0) { close(fd); }
+    }
+#endif
+}
+
+const char* PerfCounters::Name(PerfEvent event) {
+    return eventNames[static_cast<size_t>(event)];
+}
+
+bool PerfCounters::Open() {
+#ifdef __linux__
+    bool any = false;
+    for (size_t i = 0; i < m_fds.size(); ++i) {
+        if (m_fds[i] >= 0) {
+            any = true;
+            continue;
+        }
+        m_fds[i] = OpenEvent(eventConfigs[i], Leader());
+        if (m_fds[i] < 0) {
+            m_error = std::string(eventNames[i]) + ": " + std::strerror(errno);
+            continue;
+        }
+        any = true;
+    }
+    return any;
+#else
+    m_error = "hardware counters need Linux perf_event_open";
+    return false;
+#endif
+}
+
+PerfSample PerfCounters::Read() const {
+    PerfSample sample;
+#ifdef __linux__
+    const auto leader = Leader();
+    if (leader < 0) { return sample; }
+    // counter count, time enabled, time running, then the values in the order the counters joined the group
+    std::array<uint64_t, 3 + PERF_EVENT_COUNT> data{};
+    const auto bytes = read(leader, data.data(), sizeof(data));
+    if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t)) || data[2] == 0) { return sample; }
+    const auto count = std::min<uint64_t>(data[0], (static_cast<size_t>(bytes) / sizeof(uint64_t)) - 3);
+    size_t position = 0;
+    for (size_t i = 0; i < m_fds.size() && position < count; ++i) {
+        if (m_fds[i] < 0) { continue; }
+        const auto value = data[3 + position++];
+        sample.values[i] = data[1] == data[2]
+            ? value
+            : static_cast<uint64_t>(static_cast<double>(value) * static_cast<double>(data[1]) / static_cast<double>(data[2]));
+    }
+#endif
+    return sample;
+}
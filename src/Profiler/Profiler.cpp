@@ -0,0 +1,178 @@
+//
+// Created by chaku on 26/11/23.
+//
+
+#include "Profiler.hpp"
+#include "AllocTracker.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+struct ZoneEvent {
+    const char* name;
+    int64_t start;
+    int64_t end;
+    uint64_t allocations;
+};
+
+// Written only by its thread, the exporter reads [0, count). Buffers outlive their threads so a capture
+// can be exported after worker threads are gone, and are handed to the next new thread afterwards since
+// short lived threads (startup steps, benchmark pools) come and go.
+struct ThreadBuffer {
+    static constexpr size_t capacity = 1U << 16U;
+
+    uint32_t threadIndex;
+    bool inUse{true};// guarded by g_buffersMutex
+    std::unique_ptr<ZoneEvent[]> events{std::make_unique<ZoneEvent[]>(capacity)};
+    std::atomic<size_t> count{0};
+    std::atomic<uint64_t> dropped{0};
+
+    explicit ThreadBuffer(uint32_t index) : threadIndex(index) {}
+};
+
+std::mutex g_buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+std::atomic<uint64_t> g_framesLeft{0};// frames the capture still covers, 0 = until StopCapture
+std::atomic<bool> g_pendingStart{false};
+int64_t g_frameStart{-1};
+uint64_t g_frameAllocations{0};// AllocTracker::Total() at the frame start, frames count every thread
+
+uint64_t TotalAllocations() {
+    return AllocTracker::IsCompiledIn() ? AllocTracker::Total().allocations : 0;
+}
+
+ThreadBuffer* AcquireBuffer() {
+    std::lock_guard lock(g_buffersMutex);
+    for (auto& buffer : g_buffers) {
+        if (!buffer->inUse) {
+            buffer->inUse = true;
+            return buffer.get();
+        }
+    }
+    g_buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(g_buffers.size())));
+    return g_buffers.back().get();
+}
+
+// Returns the buffer to the pool when its thread exits
+struct BufferLease {
+    ThreadBuffer* buffer{AcquireBuffer()};
+
+    BufferLease() = default;
+    BufferLease(const BufferLease&) = delete;
+    BufferLease& operator=(const BufferLease&) = delete;
+    ~BufferLease() {
+        std::lock_guard lock(g_buffersMutex);
+        buffer->inUse = false;
+    }
+};
+
+ThreadBuffer& LocalBuffer() {
+    thread_local BufferLease lease;
+    return *lease.buffer;
+}
+
+void WriteEscaped(std::FILE* file, const char* text) {
+    for (; *text != '\0'; ++text) {
+        if (*text == '"' || *text == '\\') { std::fputc('\\', file); }
+        std::fputc(*text, file);
+    }
+}
+}// namespace
+
+int64_t Profiler::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::StartCapture(uint64_t frames) {
+    {
+        std::lock_guard lock(g_buffersMutex);
+        for (auto& buffer : g_buffers) {
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+    g_framesLeft.store(frames, std::memory_order_relaxed);
+    g_pendingStart.store(true, std::memory_order_release);
+}
+
+void Profiler::StopCapture() {
+    g_pendingStart.store(false, std::memory_order_relaxed);
+    capturing.store(false, std::memory_order_release);
+    g_frameStart = -1;
+}
+
+void Profiler::MarkFrame() {
+    const auto now = Now();
+    if (capturing.load(std::memory_order_relaxed)) {
+        if (g_frameStart >= 0) { Record("Frame", g_frameStart, now, TotalAllocations() - g_frameAllocations); }
+        auto framesLeft = g_framesLeft.load(std::memory_order_relaxed);
+        if (framesLeft == 1) {
+            StopCapture();
+            return;
+        }
+        if (framesLeft > 1) { g_framesLeft.store(framesLeft - 1, std::memory_order_relaxed); }
+    } else if (g_pendingStart.exchange(false, std::memory_order_acq_rel)) {
+        capturing.store(true, std::memory_order_release);
+    } else {
+        return;
+    }
+    g_frameStart = now;
+    g_frameAllocations = TotalAllocations();
+}
+
+uint64_t Profiler::ThreadAllocations() {
+    return AllocTracker::IsCompiledIn() ? AllocTracker::Thread().allocations : 0;
+}
+
+void Profiler::Record(const char* name, int64_t start, int64_t end, uint64_t allocations) {
+    auto& buffer = LocalBuffer();
+    const auto index = buffer.count.load(std::memory_order_relaxed);
+    if (index >= ThreadBuffer::capacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[index] = {name, start, end, allocations};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filePath) {
+    std::FILE* file = std::fopen(filePath.c_str(), "w");
+    if (file == nullptr) { return false; }
+
+    std::lock_guard lock(g_buffersMutex);
+    int64_t origin = INT64_MAX;
+    for (const auto& buffer : g_buffers) {
+        const auto count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) { origin = std::min(origin, buffer->events[i].start); }
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+    bool first = true;
+    for (const auto& buffer : g_buffers) {
+        const auto count = buffer->count.load(std::memory_order_acquire);
+        if (count == 0) { continue; }
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u%s\"}}",
+            first ? "" : ",\n", buffer->threadIndex, buffer->threadIndex,
+            buffer->dropped.load(std::memory_order_relaxed) > 0 ? " (buffer full, zones dropped)" : "");
+        first = false;
+        for (size_t i = 0; i < count; ++i) {
+            const auto& event = buffer->events[i];
+            std::fputs(",\n{\"name\":\"", file);
+            WriteEscaped(file, event.name);
+            // Chrome traces count in microseconds, fractions keep the nanoseconds
+            std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", buffer->threadIndex,
+                static_cast<double>(event.start - origin) / 1000.0, static_cast<double>(event.end - event.start) / 1000.0);
+            if (event.allocations > 0) {
+                std::fprintf(file, ",\"args\":{\"allocations\":%llu}", static_cast<unsigned long long>(event.allocations));
+            }
+            std::fputc('}', file);
+        }
+    }
+    std::fputs("\n]}\n", file);
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,212 @@
+//
+// Created by chaku on 28/11/23.
+//
+
+#include "Scene.hpp"
+#include "BehaviourTreeSystem.hpp"
+#include "MapInfo.hpp"
+#include "PerceptionSystem.hpp"
+#include "PrefabLoader.hpp"
+#include "RigidBodyComponent.hpp"
+#include "SpriteComponent.hpp"
+#include "StressChurnSystem.hpp"
+#include "Tags.hpp"
+#include "TransformComponent.hpp"
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr int stressSpriteSize{16};
+constexpr int stressTileSize{32};
+
+uint32_t NextRandom(uint64_t& state) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return static_cast<uint32_t>(state >> 32U);
+}
+
+// [0, 1)
+float RandomUnit(uint64_t& state) {
+  return static_cast<float>(NextRandom(state) >> 8U) / static_cast<float>(1U << 24U);
+}
+
+constexpr float agentSpeed{ 48.0F };// px/s
+constexpr float agentVision{ 64.0F };
+// Blackboard slots of the agent tree
+constexpr size_t wanderTimer{ 0 };
+constexpr size_t wanderTurns{ 1 };
+
+BtStatus SeesAgent(Entity& entity, Blackboard& /*blackboard*/, double /*deltaTime*/) {
+  return entity.registry->GetSystem<PerceptionSystem>().GetTargets(entity).empty() ? BtStatus::Failure
+                                                                                    : BtStatus::Success;
+}
+
+// head straight away from the nearest agent in sight
+BtStatus Flee(Entity& entity, Blackboard& /*blackboard*/, double /*deltaTime*/) {
+  const auto targets = entity.registry->GetSystem<PerceptionSystem>().GetTargets(entity);
+  if (targets.empty()) { return BtStatus::Failure; }
+  const auto& self = entity.GetComponent<TransformComponent>().position;
+  const auto& threat = targets.front().GetComponent<TransformComponent>().position;
+  const auto dx = self.x - threat.x;
+  const auto dy = self.y - threat.y;
+  const auto length = std::max(std::hypot(dx, dy), 0.001F);
+  entity.GetComponent<RigidBodyComponent>().velocity = Velocity(dx / length * agentSpeed, dy / length * agentSpeed);
+  return BtStatus::Success;
+}
+
+// a new heading every second, drawn from the entity id and the turns taken so far so runs are reproducible
+BtStatus Wander(Entity& entity, Blackboard& blackboard, double deltaTime) {
+  auto& timer = blackboard.values[wanderTimer];
+  timer -= static_cast<float>(deltaTime);
+  if (timer > 0.0F) { return BtStatus::Success; }
+  auto& turns = blackboard.values[wanderTurns];
+  uint64_t state = (static_cast<uint64_t>(entity.GetId()) << 32U) ^ static_cast<uint64_t>(turns);
+  turns += 1.0F;
+  timer = 1.0F;
+  const auto angle = RandomUnit(state) * 6.2831853F;
+  entity.GetComponent<RigidBodyComponent>().velocity = Velocity(std::cos(angle) * agentSpeed, std::sin(angle) * agentSpeed);
+  return BtStatus::Success;
+}
+}// namespace
+
+void LoadScene(Registry& registry, const SceneSettings& settings) {
+  if (settings.agents > 0) { SpawnAgents(registry, settings.agents, 1); }
+  if (settings.stress) {
+    LoadStressScene(registry, *settings.stress);
+    return;
+  }
+
+  PrefabLoader prefabLoader;
+  RegisterBuiltinComponents(prefabLoader);
+
+  // Create panther tank
+  if (const auto tank = prefabLoader.Load(settings.playerPrefab)) {
+    registry.Instantiate(*tank, 1);
+  }
+
+  // create tilemap, either generated or read from the hand authored map
+  if (settings.proceduralMap) {
+    const MapGenerator generator(settings.proceduralMap->settings);
+    BuildTileMap(registry, generator.Generate(settings.proceduralMap->chunksX, settings.proceduralMap->chunksY));
+  } else if (auto tileMap = LoadTileMap(settings.mapFile)) {
+    BuildTileMap(registry, *tileMap);
+  }
+}
+
+void BuildTileMap(Registry& registry, const TileMap& tileMap) {
+  constexpr int tileSize{32};
+  registry.SetResource<MapInfo>(tileMap.width, tileMap.height, static_cast<uint32_t>(tileSize));
+  for (uint32_t yPos = 0; yPos < tileMap.height; ++yPos) {
+    for (uint32_t xPos = 0; xPos < tileMap.width; ++xPos) {
+      const auto tileMapVal = tileMap.At(xPos, yPos);
+      const auto xVal = (tileMapVal / 10) * tileSize;
+      const auto yVal = (tileMapVal % 10) * tileSize;
+      auto tile = registry.CreateEntity();
+      tile.AddComponent<TransformComponent>(Position(static_cast<float>(xPos * tileSize), static_cast<float>(yPos * tileSize)),
+        Scale(1.0F, 1.0F), Rotation(0.0F));
+      tile.AddComponent<SpriteComponent>("tilemap", tileSize, tileSize, SDL_Rect(xVal, yVal, tileSize, tileSize));
+      tile.AddComponent<StaticTag>();
+    }
+  }
+}
+
+void SpawnAgents(Registry& registry, uint32_t count, uint64_t seed) {
+  // unknown tree ids are skipped by the BehaviourTreeSystem
+  auto treeId = std::numeric_limits<uint16_t>::max();
+  if (registry.HasSystem<BehaviourTreeSystem>() && registry.HasSystem<PerceptionSystem>()) {
+    treeId = registry.GetSystem<BehaviourTreeSystem>().AddTree(BehaviourTreeBuilder()
+      .Selector()
+        .Sequence().Action(SeesAgent).Action(Flee).End()
+        .Action(Wander)
+      .End().Build());
+  } else {
+    LOG_WARN("Agents need the PerceptionSystem and the BehaviourTreeSystem, spawning {} idle agents", count);
+  }
+
+  Prefab agent;
+  agent.Set<TransformComponent>(Position(0.0F, 0.0F), Scale(1.0F, 1.0F), Rotation(0.0F));
+  agent.Set<RigidBodyComponent>(Velocity(0.0F, 0.0F));
+  agent.Set<PerceptionComponent>(agentVision);
+  agent.Set<BehaviourComponent>(treeId);
+  // about one agent per vision radius squared, so most of them have a few others in sight
+  const auto side = std::sqrt(static_cast<float>(count)) * agentVision;
+  uint64_t state = seed;
+  for (const auto& entity : registry.Instantiate(agent, count)) {
+    entity.GetComponent<TransformComponent>().position = Position(RandomUnit(state) * side, RandomUnit(state) * side);
+  }
+  LOG_INFO("Agents: {} over {}x{} px", count, side, side);
+}
+
+std::string StressTextureName(uint32_t index) {
+  return "stress-" + std::to_string(index);
+}
+
+void LoadStressScene(Registry& registry, const StressSceneSettings& settings) {
+  const auto textures = std::max(settings.textures, 1U);
+  // square area that gives sprites about as much room as tiles
+  const auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(std::max(settings.tiles, 1U)))));
+  const auto side = static_cast<float>(
+    std::max(columns * stressTileSize, static_cast<uint32_t>(std::sqrt(static_cast<double>(settings.sprites)) * stressTileSize)));
+
+  Prefab tile;
+  tile.Set<TransformComponent>(Position(0.0F, 0.0F), Scale(1.0F, 1.0F), Rotation(0.0F));
+  tile.Set<SpriteComponent>(StressTextureName(0), stressTileSize, stressTileSize, SDL_Rect(0, 0, stressTileSize, stressTileSize));
+  tile.Set<StaticTag>();
+  auto tiles = registry.Instantiate(tile, settings.tiles);
+  for (uint32_t i = 0; i < tiles.size(); ++i) {
+    auto& transform = tiles[i].GetComponent<TransformComponent>();
+    transform.position = Position(static_cast<float>((i % columns) * stressTileSize), static_cast<float>((i / columns) * stressTileSize));
+    tiles[i].GetComponent<SpriteComponent>().name = StressTextureName((i % columns + i / columns) % textures);
+  }
+
+  // sprites start anywhere in the area heading anywhere at up to 64 px/s
+  auto place = [side, textures](const Entity& sprite, uint64_t& state) {
+    auto& transform = sprite.GetComponent<TransformComponent>();
+    transform.position = Position(RandomUnit(state) * side, RandomUnit(state) * side);
+    sprite.GetComponent<RigidBodyComponent>().velocity =
+      Velocity((RandomUnit(state) - 0.5F) * 128.0F, (RandomUnit(state) - 0.5F) * 128.0F);
+    sprite.GetComponent<SpriteComponent>().name = StressTextureName(NextRandom(state) % textures);
+  };
+  Prefab sprite;
+  sprite.Set<TransformComponent>(Position(0.0F, 0.0F), Scale(1.0F, 1.0F), Rotation(0.0F));
+  sprite.Set<RigidBodyComponent>(Velocity(0.0F, 0.0F));
+  sprite.Set<SpriteComponent>(StressTextureName(0), stressSpriteSize, stressSpriteSize,
+    SDL_Rect(0, 0, stressSpriteSize, stressSpriteSize));
+  sprite.Set<ChurnTag>();
+  uint64_t state = settings.seed;
+  for (const auto& entity : registry.Instantiate(sprite, settings.sprites)) { place(entity, state); }
+
+  if (settings.churnPerSecond > 0.0) {
+    registry.AddSystem<StressChurnSystem>(settings.churnPerSecond, settings.seed,
+      [place, state](Registry& target) mutable {
+        auto entity = target.CreateEntity();
+        entity.AddComponent<TransformComponent>(Position(0.0F, 0.0F), Scale(1.0F, 1.0F), Rotation(0.0F));
+        entity.AddComponent<RigidBodyComponent>(Velocity(0.0F, 0.0F));
+        entity.AddComponent<SpriteComponent>(StressTextureName(0), stressSpriteSize, stressSpriteSize,
+          SDL_Rect(0, 0, stressSpriteSize, stressSpriteSize));
+        entity.AddComponent<ChurnTag>();
+        place(entity, state);
+      });
+  }
+  LOG_INFO("Stress scene: {} sprites, {} tiles, {} textures, churn {}/s", settings.sprites, settings.tiles, textures,
+    settings.churnPerSecond);
+}
+
+std::optional<StressSceneSettings> ParseStressSettings(std::string_view text) {
+  StressSceneSettings settings;
+  std::array<uint32_t*, 3> counts{ &settings.sprites, &settings.tiles, &settings.textures };
+  for (size_t field = 0; !text.empty(); ++field) {
+    const auto comma = text.find(',');
+    const auto value = text.substr(0, comma);
+    const auto* end = value.data() + value.size();
+    const auto result = field < counts.size() ? std::from_chars(value.data(), end, *counts[field])
+                      : field == counts.size()  ? std::from_chars(value.data(), end, settings.churnPerSecond)
+                                                : std::from_chars_result{ value.data(), std::errc::invalid_argument };
+    if (result.ec != std::errc() || result.ptr != end) {
+      LOG_ERROR("Bad stress scene \"{}\", expected sprites[,tiles[,textures[,churnPerSecond]]]", std::string(text));
+      return std::nullopt;
+    }
+    text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+  }
+  return settings;
+}
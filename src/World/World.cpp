@@ -0,0 +1,100 @@
+//
+// Created by chaku on 22/11/23.
+//
+
+#include "World.hpp"
+#include "BehaviourTreeSystem.hpp"
+#include "MovementSystem.hpp"
+#include "ParallelFor.hpp"
+#include "PerceptionSystem.hpp"
+#include "Profiler.hpp"
+#include "RigidBodyComponent.hpp"
+#include "StressChurnSystem.hpp"
+#include "TimeResource.hpp"
+#include "TransformComponent.hpp"
+#include <array>
+#include <cstring>
+
+namespace {
+constexpr std::array<const char*, 6> stageNames{
+  "Registry::Update", "MovementSystem", "PerceptionSystem", "BehaviourTreeSystem", "StressChurnSystem",
+  "Registry::OptimizeLocality"
+};
+}// namespace
+
+World::World(std::shared_ptr<const AssetManager> assets) : m_assets(std::move(assets)) {
+  m_registry->SetResource<TimeResource>();
+  m_registry->AddSystem<MovementSystem>();
+  m_registry->AddSystem<PerceptionSystem>();
+  m_registry->AddSystem<BehaviourTreeSystem>();
+}
+
+std::span<const char* const> World::StageNames() {
+  return stageNames;
+}
+
+template <typename TFunc>
+void World::RunStage(size_t stage, TFunc&& fn) {
+  PROFILE_SCOPE(stageNames[stage]);
+  if (m_stageObserver != nullptr) { m_stageObserver->BeginStage(stage); }
+  fn();
+  if (m_stageObserver != nullptr) { m_stageObserver->EndStage(stage); }
+}
+
+void World::Step(double deltaTime) {
+  PROFILE_SCOPE("World::Step");
+  auto& time = m_registry->GetResource<TimeResource>();
+  time.deltaTime = deltaTime;
+  time.elapsed += deltaTime;
+  ++time.frame;
+
+  RunStage(0, [this] { m_registry->Update(); });
+  RunStage(1, [this] { m_registry->GetSystem<MovementSystem>().Update(); });
+  RunStage(2, [this] { m_registry->GetSystem<PerceptionSystem>().Update(); });
+  RunStage(3, [this] { m_registry->GetSystem<BehaviourTreeSystem>().Update(); });
+  // only stress scenes with churn register it
+  if (m_registry->HasSystem<StressChurnSystem>()) {
+    RunStage(4, [this] { m_registry->GetSystem<StressChurnSystem>().Update(); });
+  }
+  if (m_localityBudget.count() > 0) {
+    RunStage(5, [this] { m_registry->OptimizeLocality(m_localityBudget); });
+  }
+}
+
+void RunWorlds(std::span<World> worlds, uint64_t frames, double deltaTime) {
+  // one world per pool thread, the ParallelFor inside a world's systems then runs inline
+  ParallelFor(worlds.size(), [&](size_t index) {
+    for (uint64_t frame = 0; frame < frames; ++frame) { worlds[index].Step(deltaTime); }
+  });
+}
+
+uint64_t HashWorldState(World& world) {
+  // FNV-1a over the fields one at a time, padding bytes never reach the hash
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](const auto& value) {
+    std::array<unsigned char, sizeof(value)> bytes{};
+    std::memcpy(bytes.data(), &value, sizeof(value));
+    for (const auto byte : bytes) { hash = (hash ^ byte) * 1099511628211ULL; }
+  };
+  auto& registry = world.GetRegistry();
+  for (size_t id = 0; id < registry.GetEntityCount(); ++id) {
+    Entity entity(id);
+    entity.registry = &registry;
+    const auto& signature = registry.GetSignature(entity);
+    mix(signature.to_ullong());
+    if (entity.HasComponent<TransformComponent>()) {
+      const auto& transform = entity.GetComponent<TransformComponent>();
+      mix(transform.position.x);
+      mix(transform.position.y);
+      mix(transform.scale.x);
+      mix(transform.scale.y);
+      mix(transform.rotation);
+    }
+    if (entity.HasComponent<RigidBodyComponent>()) {
+      const auto& rigidBody = entity.GetComponent<RigidBodyComponent>();
+      mix(rigidBody.velocity.x);
+      mix(rigidBody.velocity.y);
+    }
+  }
+  return hash;
+}
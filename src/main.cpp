@@ -1,10 +1,51 @@
 #include "GameState.hpp"
+#include "Profiler.hpp"
+#include <cstring>
+#include <string>
 
 // NOLINTNEXTLINE(bugprone-exception-escape)
-int main() {
+int main(int argc, char* argv[]) {
+    LoggerConfig logConfig;
+    std::string traceFile;
+    uint64_t traceFrames = 300;
+    for (int i = 1; i + 1 < argc; ++i) {
+        // --binary-log <file> : write raw log records to file, render them with stabby2d_logdecode
+        if (std::strcmp(argv[i], "--binary-log") == 0) {
+            logConfig.binaryFile = argv[i + 1];
+        }
+        // --trace <file> [--trace-frames <n>] : Chrome trace of the first n frames (needs STABBY2D_PROFILING)
+        if (std::strcmp(argv[i], "--trace") == 0) {
+            traceFile = argv[i + 1];
+        }
+        if (std::strcmp(argv[i], "--trace-frames") == 0) {
+            traceFrames = std::stoull(argv[i + 1]);
+        }
+    }
+    Logger::StartAsync(logConfig);
     GameState game;
+    for (int i = 1; i < argc; ++i) {
+        // --procedural-map <seed> : generate an 8x8 chunk map instead of loading jungle.map
+        if (std::strcmp(argv[i], "--procedural-map") == 0 && i + 1 < argc) {
+            MapGeneratorSettings settings;
+            settings.seed = std::stoull(argv[++i]);
+            game.UseProceduralMap(settings, 8, 8);
+        }
+        // --stress <sprites[,tiles[,textures[,churnPerSecond]]]> : generated scene for scaling tests
+        if (std::strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+            if (const auto settings = ParseStressSettings(argv[++i])) { game.UseStressScene(*settings); }
+        }
+    }
+    if (!traceFile.empty()) {
+        if (!Profiler::IsCompiledIn()) {
+            LOG_WARN("Built without STABBY2D_PROFILING, {} will contain no zones", traceFile);
+        }
+        Profiler::StartCapture(traceFrames);
+    }
     game.Initialize();
     game.Run();
+    if (!traceFile.empty() && !Profiler::WriteChromeTrace(traceFile)) {
+        LOG_ERROR("Could not write trace to {}", traceFile);
+    }
     game.Destroy();
     return 0;
 }
@@ -0,0 +1,72 @@
+//
+// Created by chaku on 12/12/23.
+//
+
+// A killed entity must leave every system that tracks it, also when it lost one of the system's required
+// components before dying, otherwise the system keeps processing whatever entity reuses the ID.
+
+#include "ECS.hpp"
+#include "LogSinks.hpp"
+#include "RigidBodyComponent.hpp"
+#include "TransformComponent.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+namespace {
+int failures = 0;
+
+void Expect(bool condition, const char* what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+class MovingSystem : public System {
+public:
+  MovingSystem() {
+    RequireComponent<TransformComponent>();
+    RequireComponent<RigidBodyComponent>();
+  }
+};
+
+bool Contains(const System& system, const Entity& entity) {
+  const auto entities = system.GetEntities();
+  return std::find(entities.begin(), entities.end(), entity) != entities.end();
+}
+}// namespace
+
+int main() {
+  LoggerConfig logConfig;
+  logConfig.sinks = { std::make_shared<RingSink>(1U << 16U) };
+  Logger::StartAsync(logConfig);
+
+  Registry registry;
+  registry.AddSystem<MovingSystem>();
+  const auto& system = registry.GetSystem<MovingSystem>();
+
+  auto entity = registry.CreateEntity();
+  entity.AddComponent<TransformComponent>();
+  entity.AddComponent<RigidBodyComponent>();
+  registry.Update();
+  Expect(Contains(system, entity), "the system tracks the entity");
+
+  entity.RemoveComponent<RigidBodyComponent>();
+  registry.Update();
+  registry.KillEntity(entity);
+  registry.Update();
+  Expect(!Contains(system, entity), "a killed entity leaves the system after losing a required component");
+  Expect(!system.Tracks(entity), "the system no longer reports the killed entity as tracked");
+
+  // the recycled ID without the system's components must not show up in it
+  auto recycled = registry.CreateEntity();
+  recycled.AddComponent<TransformComponent>();
+  registry.Update();
+  Expect(recycled.GetId() == entity.GetId(), "the ID is recycled");
+  Expect(system.GetEntityCount() == 0, "the system doesn't process the recycled entity");
+
+  Logger::Stop();
+  if (failures == 0) { std::puts("EcsKillTest passed"); }
+  return failures == 0 ? 0 : 1;
+}
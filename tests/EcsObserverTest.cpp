@@ -0,0 +1,65 @@
+//
+// Created by chaku on 11/12/23.
+//
+
+// Component observers registered from inside an observer callback, including for the type being dispatched,
+// must neither disturb the running dispatch nor see the events that are being dispatched.
+
+#include "ECS.hpp"
+#include "LogSinks.hpp"
+#include "RigidBodyComponent.hpp"
+#include "TransformComponent.hpp"
+#include <cstdio>
+#include <memory>
+
+namespace {
+int failures = 0;
+
+void Expect(bool condition, const char* what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+}// namespace
+
+int main() {
+  LoggerConfig logConfig;
+  logConfig.sinks = { std::make_shared<RingSink>(1U << 16U) };
+  Logger::StartAsync(logConfig);
+
+  Registry registry;
+  size_t outerCalls = 0;
+  size_t innerAddedCalls = 0;
+  size_t innerRemovedCalls = 0;
+  registry.OnComponentAdded<TransformComponent>([&](std::span<const Entity> entities) {
+    ++outerCalls;
+    Expect(entities.size() == 1, "the outer observer sees one entity per Update");
+    if (outerCalls > 1) { return; }
+    // enough to force the callback list to reallocate if it grew in place
+    for (int i = 0; i < 16; ++i) {
+      registry.OnComponentAdded<TransformComponent>([&](std::span<const Entity>) { ++innerAddedCalls; });
+    }
+    registry.OnComponentRemoved<RigidBodyComponent>([&](std::span<const Entity>) { ++innerRemovedCalls; });
+  });
+
+  auto first = registry.CreateEntity();
+  first.AddComponent<TransformComponent>();
+  registry.Update();
+  Expect(outerCalls == 1, "the outer observer runs once");
+  Expect(innerAddedCalls == 0, "observers registered during dispatch skip the events being dispatched");
+
+  auto second = registry.CreateEntity();
+  second.AddComponent<TransformComponent>();
+  second.AddComponent<RigidBodyComponent>();
+  registry.Update();
+  second.RemoveComponent<RigidBodyComponent>();
+  registry.Update();
+  Expect(outerCalls == 2, "the outer observer keeps running");
+  Expect(innerAddedCalls == 16, "observers registered during dispatch see later events");
+  Expect(innerRemovedCalls == 1, "removal observers registered during dispatch see later events");
+
+  Logger::Stop();
+  if (failures == 0) { std::puts("EcsObserverTest passed"); }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+//
+// Created by chaku on 08/12/23.
+//
+
+// Compares a stabby2d_bench --json report against a baseline report and fails (exit code 1) when any benchmark
+// got slower than its tolerance allows or disappeared from the report. Medians (ns_per_item) are compared.
+// Benchmarks missing from the baseline are listed but don't fail, record them by regenerating the baseline:
+//   cmake --build <build dir> --target bench_baseline   (or stabby2d_bench --json <baseline.json>)
+// Baselines only mean something on the machine (and build type) that produced them, so when the baseline is
+// missing or its "host" or "build_type" differ the gate skips (exit code 77, ctest's SKIP_RETURN_CODE) rather
+// than report noise as regressions.
+// Usage: stabby2d_bench_gate <baseline.json> <current.json> [--tolerance <fraction>]
+//                            [--tolerance <name prefix>=<fraction>]...
+// e.g. --tolerance 0.3 --tolerance Assets/=0.5 allows 30% slowdown, 50% for the asset benchmarks.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr int SKIPPED = 77;
+
+// Just enough JSON for the report BenchHarness::WriteJson writes: the top level string fields and the
+// "results" array of flat objects, of which name and ns_per_item are kept.
+class ReportReader {
+    const std::string& m_text;
+    size_t m_pos{ 0 };
+
+    void SkipSpace() {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos])) != 0) { ++m_pos; }
+    }
+    bool Consume(char expected) {
+        SkipSpace();
+        if (m_pos >= m_text.size() || m_text[m_pos] != expected) { return false; }
+        ++m_pos;
+        return true;
+    }
+    std::optional<std::string> String() {
+        if (!Consume('"')) { return std::nullopt; }
+        std::string value;
+        for (; m_pos < m_text.size() && m_text[m_pos] != '"'; ++m_pos) {
+            if (m_text[m_pos] == '\\' && m_pos + 1 < m_text.size()) { ++m_pos; }
+            value += m_text[m_pos];
+        }
+        if (!Consume('"')) { return std::nullopt; }
+        return value;
+    }
+    // numbers, true, false and null, as text
+    std::string Scalar() {
+        SkipSpace();
+        const auto start = m_pos;
+        while (m_pos < m_text.size() && std::strchr(",}] \t\r\n", m_text[m_pos]) == nullptr) { ++m_pos; }
+        return m_text.substr(start, m_pos - start);
+    }
+
+public:
+    explicit ReportReader(const std::string& text) : m_text(text) {}
+
+    // @return value of a top level string field, std::nullopt if the report has none (older reports)
+    std::optional<std::string> Field(const std::string& name) {
+        const auto key = m_text.find("\"" + name + "\"");
+        const auto results = m_text.find("\"results\"");
+        if (key == std::string::npos || key > results) { return std::nullopt; }
+        m_pos = key + name.size() + 2;
+        if (!Consume(':')) { return std::nullopt; }
+        return String();
+    }
+
+    // @return benchmark name to median ns per item, std::nullopt if the report is malformed
+    std::optional<std::map<std::string, double>> Results() {
+        const auto key = m_text.find("\"results\"");
+        if (key == std::string::npos) { return std::nullopt; }
+        m_pos = key + std::strlen("\"results\"");
+        if (!Consume(':') || !Consume('[')) { return std::nullopt; }
+        std::map<std::string, double> results;
+        if (Consume(']')) { return results; }
+        do {
+            if (!Consume('{')) { return std::nullopt; }
+            std::optional<std::string> name;
+            std::optional<double> nsPerItem;
+            do {
+                const auto field = String();
+                if (!field || !Consume(':')) { return std::nullopt; }
+                SkipSpace();
+                if (m_pos < m_text.size() && m_text[m_pos] == '"') {
+                    auto value = String();
+                    if (!value) { return std::nullopt; }
+                    if (*field == "name") { name = std::move(*value); }
+                } else {
+                    const auto value = Scalar();
+                    if (*field == "ns_per_item") {
+                        try {
+                            nsPerItem = std::stod(value);
+                        } catch (const std::exception&) {
+                            return std::nullopt;
+                        }
+                    }
+                }
+            } while (Consume(','));
+            if (!Consume('}') || !name || !nsPerItem) { return std::nullopt; }
+            results[*name] = *nsPerItem;
+        } while (Consume(','));
+        if (!Consume(']')) { return std::nullopt; }
+        return results;
+    }
+};
+
+struct Report {
+    std::optional<std::string> buildType;
+    std::optional<std::string> host;
+    std::map<std::string, double> results;
+};
+
+std::optional<Report> ReadReport(const char* filePath) {
+    std::ifstream file(filePath);
+    if (!file) {
+        std::fprintf(stderr, "could not open %s\n", filePath);
+        return std::nullopt;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    const auto contents = text.str();
+    ReportReader reader(contents);
+    auto results = reader.Results();
+    if (!results) {
+        std::fprintf(stderr, "%s is not a stabby2d_bench json report\n", filePath);
+        return std::nullopt;
+    }
+    return Report{ reader.Field("build_type"), reader.Field("host"), std::move(*results) };
+}
+
+// @return false (and says why) if the reports come from different machines or build types
+bool Comparable(const Report& baseline, const Report& current, const char* baselinePath) {
+    bool comparable = true;
+    auto check = [&](const char* field, const std::optional<std::string>& before,
+                     const std::optional<std::string>& after) {
+        if (before && after && *before == *after) { return; }
+        std::fprintf(stderr, "%s \"%s\" differs: baseline %s, current %s\n", baselinePath, field,
+            before ? before->c_str() : "(not recorded)", after ? after->c_str() : "(not recorded)");
+        comparable = false;
+    };
+    check("build_type", baseline.buildType, current.buildType);
+    check("host", baseline.host, current.host);
+    if (!comparable) {
+        std::fprintf(stderr, "skipped, record a baseline on this machine and build type:\n"
+                             "  cmake --build <build dir> --target bench_baseline\n");
+    }
+    return comparable;
+}
+
+struct Tolerances {
+    double fallback{ 0.30 };
+    std::vector<std::pair<std::string, double>> byPrefix;// the longest matching prefix wins
+
+    double For(const std::string& name) const {
+        double tolerance = fallback;
+        size_t matched = 0;
+        for (const auto& [prefix, value] : byPrefix) {
+            if (prefix.size() >= matched && name.compare(0, prefix.size(), prefix) == 0) {
+                tolerance = value;
+                matched = prefix.size();
+            }
+        }
+        return tolerance;
+    }
+};
+}// namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <baseline.json> <current.json> [--tolerance [<name prefix>=]<fraction>]...\n",
+            argv[0]);
+        return 1;
+    }
+    Tolerances tolerances;
+    for (int i = 3; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--tolerance") != 0) { continue; }
+        const std::string value = argv[++i];
+        const auto equals = value.rfind('=');
+        try {
+            if (equals == std::string::npos) {
+                tolerances.fallback = std::stod(value);
+            } else {
+                tolerances.byPrefix.emplace_back(value.substr(0, equals), std::stod(value.substr(equals + 1)));
+            }
+        } catch (const std::exception&) {
+            std::fprintf(stderr, "bad tolerance \"%s\"\n", value.c_str());
+            return 1;
+        }
+    }
+
+    if (!std::ifstream(argv[1])) {
+        std::fprintf(stderr, "skipped, no baseline at %s, record one on this machine and build type:\n"
+                             "  cmake --build <build dir> --target bench_baseline\n", argv[1]);
+        return SKIPPED;
+    }
+    const auto baselineReport = ReadReport(argv[1]);
+    const auto currentReport = ReadReport(argv[2]);
+    if (!baselineReport || !currentReport) { return 1; }
+    if (!Comparable(*baselineReport, *currentReport, argv[1])) { return SKIPPED; }
+    const auto& baseline = baselineReport->results;
+    const auto& current = currentReport->results;
+
+    size_t regressed = 0;
+    size_t missing = 0;
+    std::printf("%-40s %12s %12s %9s %9s  %s\n", "benchmark (ns/item)", "baseline", "current", "change", "allowed",
+        "status");
+    for (const auto& [name, before] : baseline) {
+        const auto tolerance = tolerances.For(name);
+        const auto found = current.find(name);
+        if (found == current.end()) {
+            std::printf("%-40s %12.2f %12s %9s %8.0f%%  MISSING\n", name.c_str(), before, "-", "-", tolerance * 100.0);
+            ++missing;
+            continue;
+        }
+        const auto after = found->second;
+        const auto change = before > 0.0 ? after / before - 1.0 : 0.0;
+        const char* status = "ok";
+        if (change > tolerance) {
+            status = "REGRESSED";
+            ++regressed;
+        } else if (change < -tolerance) {
+            status = "faster, consider updating the baseline";
+        }
+        std::printf("%-40s %12.2f %12.2f %+8.1f%% %8.0f%%  %s\n", name.c_str(), before, after, change * 100.0,
+            tolerance * 100.0, status);
+    }
+    for (const auto& [name, after] : current) {
+        if (baseline.find(name) == baseline.end()) {
+            std::printf("%-40s %12s %12.2f %9s %9s  new, not in the baseline\n", name.c_str(), "-", after, "-", "-");
+        }
+    }
+
+    if (regressed > 0 || missing > 0) {
+        std::printf("FAILED: %zu of %zu benchmarks regressed, %zu missing from %s\n", regressed, baseline.size(),
+            missing, argv[2]);
+        return 1;
+    }
+    std::printf("passed: %zu benchmarks within tolerance of %s\n", baseline.size(), argv[1]);
+    return 0;
+}
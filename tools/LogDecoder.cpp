@@ -0,0 +1,161 @@
+//
+// Created by chaku on 24/11/23.
+//
+
+// Renders a binary log written with LoggerConfig::binaryFile as text or as JSON lines.
+// Usage: stabby2d_logdecode <file> [--json]
+
+#include "Logger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace {
+// a site read back from the file, owns the strings the LogSite points at so it must not move once the LogSite
+// exists (std::map nodes don't)
+struct DecodedSite {
+    std::string file;
+    std::string format;
+    std::unique_ptr<LogSite> site;
+};
+
+template <typename T>
+bool Read(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool ReadText(std::istream& in, std::string& text) {
+    uint16_t length = 0;
+    if (!Read(in, length)) {
+        return false;
+    }
+    text.resize(length);
+    return static_cast<bool>(in.read(text.data(), length));
+}
+
+const char* LevelName(LogLevel lvl) {
+    switch (lvl) {
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARN: return "WARN";
+        case LogLevel::ERR: return "ERR";
+        default: return "?";
+    }
+}
+
+std::string JsonString(std::string_view text) {
+    std::string out = "\"";
+    for (const char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    std::array<char, 8> escaped{};
+                    std::snprintf(escaped.data(), escaped.size(), "\\u%04x", c);
+                    out += escaped.data();
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+void PrintText(const LogRecord& record, int64_t wallClockOffset) {
+    const auto nanoseconds = record.timestamp + wallClockOffset;
+    const auto seconds = static_cast<std::time_t>(nanoseconds / 1'000'000'000);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    std::array<char, 32> stamp{};
+    std::strftime(stamp.data(), stamp.size(), "%d-%m-%Y %H:%M:%S", &local);
+    std::printf("%s.%06lld | %-4s | %s\n", stamp.data(), static_cast<long long>(nanoseconds % 1'000'000'000 / 1000),
+        LevelName(record.site->lvl), FormatLogMessage(record).c_str());
+}
+
+void PrintJson(const LogRecord& record, int64_t wallClockOffset) {
+    std::string args;
+    ForEachLogArg(record, [&args](LogArgType type, std::string_view text) {
+        if (!args.empty()) {
+            args += ',';
+        }
+        const auto quoted = type == LogArgType::String || type == LogArgType::Char || type == LogArgType::Pointer;
+        // %g writes inf and nan, which JSON has no numbers for
+        const auto finite = type != LogArgType::Double || text.find_first_of("in") == std::string_view::npos;
+        args += quoted ? JsonString(text) : finite ? std::string(text) : std::string("null");
+    });
+    std::printf("{\"time_ns\":%lld,\"monotonic_ns\":%lld,\"level\":\"%s\",\"site\":%u,\"file\":%s,\"line\":%d,"
+                "\"message\":%s,\"args\":[%s],\"truncated\":%s}\n",
+        static_cast<long long>(record.timestamp + wallClockOffset), static_cast<long long>(record.timestamp),
+        LevelName(record.site->lvl), record.site->id, JsonString(record.site->file).c_str(), record.site->line,
+        JsonString(FormatLogMessage(record)).c_str(), args.c_str(), record.truncated ? "true" : "false");
+}
+}// namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <file> [--json]\n", argv[0]);
+        return 2;
+    }
+    const bool json = argc > 2 && std::strcmp(argv[2], "--json") == 0;
+    std::ifstream in(argv[1], std::ios::binary);
+    std::array<char, 8> magic{};
+    uint32_t version = 0;
+    int64_t wallClockOffset = 0;
+    if (!in.read(magic.data(), magic.size()) || magic != LOG_FILE_MAGIC || !Read(in, version)
+        || version != LOG_FILE_VERSION || !Read(in, wallClockOffset)) {
+        std::fprintf(stderr, "%s is not a version %u binary log\n", argv[1], LOG_FILE_VERSION);
+        return 1;
+    }
+
+    // keyed by id rather than indexed by it, a corrupt file can't make the decoder allocate for 4 billion sites
+    std::map<uint32_t, DecodedSite> sites;
+    bool complete = true;
+    uint8_t tag = 0;
+    while (complete && Read(in, tag)) {
+        if (tag == static_cast<uint8_t>(LogFileTag::Site)) {
+            uint32_t id = 0;
+            uint8_t level = 0;
+            int32_t line = 0;
+            DecodedSite decoded;
+            if (!Read(in, id) || !Read(in, level) || !Read(in, line) || !ReadText(in, decoded.file)
+                || !ReadText(in, decoded.format)) {
+                complete = false;
+                continue;
+            }
+            auto& site = sites[id] = std::move(decoded);
+            site.site = std::make_unique<LogSite>(static_cast<LogLevel>(level), site.format.c_str(), site.file.c_str(),
+                line, id);
+        } else if (tag == static_cast<uint8_t>(LogFileTag::Record)) {
+            uint32_t id = 0;
+            uint8_t truncated = 0;
+            LogRecord record;
+            if (!Read(in, id) || !Read(in, record.timestamp) || !Read(in, truncated) || !Read(in, record.length)
+                || record.length > record.payload.size() || !in.read(record.payload.data(), record.length)) {
+                complete = false;
+                continue;
+            }
+            const auto found = sites.find(id);
+            if (found == sites.end()) {
+                std::fprintf(stderr, "record refers to unknown site %u\n", id);
+                return 1;
+            }
+            record.site = found->second.site.get();
+            record.truncated = truncated != 0;
+            json ? PrintJson(record, wallClockOffset) : PrintText(record, wallClockOffset);
+        } else {
+            std::fprintf(stderr, "unknown entry tag %u\n", tag);
+            return 1;
+        }
+    }
+    if (!complete) {
+        std::fprintf(stderr, "%s ends in the middle of an entry\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}